@@ -0,0 +1,44 @@
+// Counts heap allocations made through operator new, which is how the runtime creates every
+// SmallBasic value. Preloaded into benchmark programs, the total is written to
+// $SMALLBASIC_ALLOC_COUNT_FILE when the program exits; the runtime microbenchmarks link it
+// directly and read smallbasic_allocation_count().
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+static std::atomic<unsigned long long> g_allocations = 0;
+
+static void* counted_alloc(const std::size_t size) {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* ptr = std::malloc(size ? size : 1)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+extern "C" unsigned long long smallbasic_allocation_count() {
+    return g_allocations.load(std::memory_order_relaxed);
+}
+
+void* operator new(const std::size_t size) { return counted_alloc(size); }
+void* operator new[](const std::size_t size) { return counted_alloc(size); }
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+void operator delete[](void* ptr) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::size_t) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, std::size_t) noexcept { std::free(ptr); }
+
+// the preloaded library is finalized after the program's own destructors and atexit handlers
+struct AllocationReport {
+    ~AllocationReport() {
+        const char* path = std::getenv("SMALLBASIC_ALLOC_COUNT_FILE");
+        if (!path) return;
+
+        if (std::FILE* file = std::fopen(path, "w")) {
+            std::fprintf(file, "%llu\n", g_allocations.load());
+            std::fclose(file);
+        }
+    }
+};
+
+static AllocationReport g_report;
@@ -0,0 +1,415 @@
+// Compiles and runs every program of the benchmark corpus, records compile time, run time,
+// peak RSS and allocation counts as JSON, and compares the results against a stored baseline
+// with Welch's t-test.
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <numeric>
+#include <string>
+#include <vector>
+
+#include <cxxopts.hpp>
+#include <fmt/format.h>
+#include <llvm/Support/FormatVariadic.h>
+#include <llvm/Support/JSON.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/raw_ostream.h>
+#include <spdlog/spdlog.h>
+
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+struct ProcessResult {
+    int exitCode;
+    double wallMs;
+    double peakRssKb;
+};
+
+static ProcessResult runProcess(const std::vector<std::string>& args,
+                                const std::vector<std::pair<std::string, std::string>>& env) {
+    const auto start = std::chrono::steady_clock::now();
+
+    const pid_t pid = fork();
+    if (pid < 0) {
+        spdlog::error("fork failed");
+        std::exit(1);
+    }
+
+    if (pid == 0) {
+        // only the measurements matter, program and compiler output would skew the output-heavy programs,
+        // and the runtime's closing "Press any key" prompt must read EOF rather than wait on a terminal
+        const int devNullIn = open("/dev/null", O_RDONLY);
+        const int devNullOut = open("/dev/null", O_WRONLY);
+        if (devNullIn < 0 || devNullOut < 0) {
+            _exit(127);
+        }
+        dup2(devNullIn, STDIN_FILENO);
+        dup2(devNullOut, STDOUT_FILENO);
+        dup2(devNullOut, STDERR_FILENO);
+
+        for (const auto& [name, value] : env) {
+            setenv(name.c_str(), value.c_str(), 1);
+        }
+
+        std::vector<char*> argv;
+        for (const auto& arg : args) {
+            argv.push_back(const_cast<char*>(arg.c_str()));
+        }
+        argv.push_back(nullptr);
+
+        execv(argv[0], argv.data());
+        _exit(127);
+    }
+
+    int status = 0;
+    rusage usage{};
+    wait4(pid, &status, 0, &usage);
+
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+    return {
+        WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status),
+        std::chrono::duration<double, std::milli>(elapsed).count(),
+        static_cast<double>(usage.ru_maxrss)
+    };
+}
+
+struct Samples {
+    std::vector<double> compileMs;
+    std::vector<double> runMs;
+    std::vector<double> peakRssKb;
+    double allocations = 0;
+    std::string failure; // why the program could not be measured, empty if it was
+};
+
+static double mean(const std::vector<double>& values) {
+    return std::accumulate(values.begin(), values.end(), 0.0) / static_cast<double>(values.size());
+}
+
+static double variance(const std::vector<double>& values) {
+    if (values.size() < 2) return 0;
+    const double m = mean(values);
+    double sum = 0;
+    for (const double v : values) {
+        sum += (v - m) * (v - m);
+    }
+    return sum / static_cast<double>(values.size() - 1);
+}
+
+// continued fraction for the regularized incomplete beta function (modified Lentz)
+static double betaContinuedFraction(const double a, const double b, const double x) {
+    constexpr double tiny = 1e-300;
+    const double qab = a + b, qap = a + 1, qam = a - 1;
+
+    double c = 1;
+    double d = 1 - qab * x / qap;
+    if (std::abs(d) < tiny) d = tiny;
+    d = 1 / d;
+    double h = d;
+
+    for (int m = 1; m <= 200; ++m) {
+        const int m2 = 2 * m;
+        double aa = m * (b - m) * x / ((qam + m2) * (a + m2));
+        d = 1 + aa * d;
+        if (std::abs(d) < tiny) d = tiny;
+        c = 1 + aa / c;
+        if (std::abs(c) < tiny) c = tiny;
+        d = 1 / d;
+        h *= d * c;
+
+        aa = -(a + m) * (qab + m) * x / ((a + m2) * (qap + m2));
+        d = 1 + aa * d;
+        if (std::abs(d) < tiny) d = tiny;
+        c = 1 + aa / c;
+        if (std::abs(c) < tiny) c = tiny;
+        d = 1 / d;
+        const double delta = d * c;
+        h *= delta;
+        if (std::abs(delta - 1) < 1e-12) break;
+    }
+    return h;
+}
+
+static double incompleteBeta(const double a, const double b, const double x) {
+    if (x <= 0) return 0;
+    if (x >= 1) return 1;
+    const double front = std::exp(std::lgamma(a + b) - std::lgamma(a) - std::lgamma(b) +
+                                  a * std::log(x) + b * std::log(1 - x));
+    if (x < (a + 1) / (a + b + 2)) {
+        return front * betaContinuedFraction(a, b, x) / a;
+    }
+    return 1 - front * betaContinuedFraction(b, a, 1 - x) / b;
+}
+
+// two-sided p-value of Welch's t-test for a difference in means
+static double welchPValue(const std::vector<double>& a, const std::vector<double>& b) {
+    const double va = variance(a) / static_cast<double>(a.size());
+    const double vb = variance(b) / static_cast<double>(b.size());
+
+    if (va + vb == 0) {
+        return mean(a) == mean(b) ? 1 : 0;
+    }
+
+    const double t = (mean(a) - mean(b)) / std::sqrt(va + vb);
+    const double df = (va + vb) * (va + vb) /
+                      (va * va / static_cast<double>(a.size() - 1) + vb * vb / static_cast<double>(b.size() - 1));
+    return incompleteBeta(df / 2, 0.5, df / (df + t * t));
+}
+
+static llvm::json::Array toJson(const std::vector<double>& values) {
+    llvm::json::Array array;
+    for (const double v : values) {
+        array.push_back(v);
+    }
+    return array;
+}
+
+static std::vector<double> fromJson(const llvm::json::Array* array) {
+    std::vector<double> values;
+    if (!array) return values;
+    for (const auto& v : *array) {
+        if (auto number = v.getAsNumber()) {
+            values.push_back(*number);
+        }
+    }
+    return values;
+}
+
+static llvm::json::Value resultsToJson(const std::map<std::string, Samples>& results, const unsigned runs) {
+    llvm::json::Object benchmarks;
+    for (const auto& [name, samples] : results) {
+        llvm::json::Object entry{
+            {"compile_ms", toJson(samples.compileMs)},
+            {"run_ms", toJson(samples.runMs)},
+            {"peak_rss_kb", toJson(samples.peakRssKb)},
+            {"allocations", samples.allocations},
+        };
+        if (!samples.failure.empty()) {
+            entry["failure"] = samples.failure;
+        }
+        benchmarks[name] = std::move(entry);
+    }
+    return llvm::json::Object{{"runs", runs}, {"benchmarks", std::move(benchmarks)}};
+}
+
+static std::map<std::string, Samples> resultsFromJson(const llvm::json::Value& value) {
+    std::map<std::string, Samples> results;
+    const auto* root = value.getAsObject();
+    const auto* benchmarks = root ? root->getObject("benchmarks") : nullptr;
+    if (!benchmarks) return results;
+
+    for (const auto& [name, entry] : *benchmarks) {
+        const auto* object = entry.getAsObject();
+        if (!object) continue;
+        Samples& samples = results[name.str()];
+        samples.compileMs = fromJson(object->getArray("compile_ms"));
+        samples.runMs = fromJson(object->getArray("run_ms"));
+        samples.peakRssKb = fromJson(object->getArray("peak_rss_kb"));
+        samples.allocations = object->getNumber("allocations").value_or(0);
+        samples.failure = object->getString("failure").value_or("").str();
+    }
+    return results;
+}
+
+static void writeJson(const fs::path& path, const llvm::json::Value& value) {
+    std::error_code ec;
+    llvm::raw_fd_ostream out(path.string(), ec);
+    if (ec) {
+        spdlog::error("Could not write {}: {}", path.string(), ec.message());
+        std::exit(1);
+    }
+    out << llvm::formatv("{0:2}", value) << "\n";
+}
+
+// Prints one row per metric and returns whether any metric regressed significantly.
+static bool compare(const std::map<std::string, Samples>& baseline, const std::map<std::string, Samples>& current,
+                    const double alpha, const double thresholdPercent) {
+    bool regressed = false;
+
+    std::cout << fmt::format("{:<22} {:<12} {:>12} {:>12} {:>9} {:>8}  {}\n",
+                             "benchmark", "metric", "baseline", "current", "change", "p", "verdict");
+
+    const auto row = [&](const std::string& name, const std::string& metric,
+                         const std::vector<double>& before, const std::vector<double>& after) {
+        if (before.size() < 2 || after.size() < 2) return;
+
+        const double b = mean(before), a = mean(after);
+        const double change = b != 0 ? (a - b) / b * 100 : 0;
+        const double p = welchPValue(before, after);
+
+        std::string verdict = "unchanged";
+        if (p < alpha && std::abs(change) >= thresholdPercent) {
+            verdict = change > 0 ? "REGRESSION" : "improvement";
+            regressed |= change > 0;
+        }
+
+        std::cout << fmt::format("{:<22} {:<12} {:>12.2f} {:>12.2f} {:>+8.1f}% {:>8.4f}  {}\n",
+                                 name, metric, b, a, change, p, verdict);
+    };
+
+    for (const auto& [name, after] : current) {
+        const auto it = baseline.find(name);
+        if (it == baseline.end()) {
+            std::cout << fmt::format("{:<22} not in baseline\n", name);
+            continue;
+        }
+        const Samples& before = it->second;
+
+        // a program that can't be measured any more is a regression, one that couldn't before has nothing to compare
+        if (!after.failure.empty()) {
+            std::cout << fmt::format("{:<22} FAILED: {}\n", name, after.failure);
+            regressed = true;
+            continue;
+        }
+        if (!before.failure.empty()) {
+            std::cout << fmt::format("{:<22} failed in baseline: {}\n", name, before.failure);
+            continue;
+        }
+
+        row(name, "compile_ms", before.compileMs, after.compileMs);
+        row(name, "run_ms", before.runMs, after.runMs);
+        row(name, "peak_rss_kb", before.peakRssKb, after.peakRssKb);
+
+        // allocation counts are deterministic, any increase is a regression
+        const std::string verdict = after.allocations > before.allocations ? "REGRESSION"
+                                  : after.allocations < before.allocations ? "improvement" : "unchanged";
+        regressed |= after.allocations > before.allocations;
+        std::cout << fmt::format("{:<22} {:<12} {:>12.0f} {:>12.0f} {:>9} {:>8}  {}\n",
+                                 name, "allocations", before.allocations, after.allocations, "", "", verdict);
+    }
+
+    return regressed;
+}
+
+int main(int argc, char** argv) {
+    cxxopts::Options options("SmallBasicBenchmarkHarness", "End-to-end benchmarks for SmallBasicCompiler");
+    options.add_options()
+        ("compiler", "Path to SmallBasicCompiler", cxxopts::value<std::string>())
+        ("std-path", "Path to libSmallBasicLibrary.a", cxxopts::value<std::string>())
+        ("alloc-counter", "Library preloaded into programs to count allocations", cxxopts::value<std::string>())
+        ("corpus", "Directory of .sb benchmark programs", cxxopts::value<std::string>())
+        ("work-dir", "Directory for compiled programs", cxxopts::value<std::string>()->default_value("bench-work"))
+        ("output", "Results JSON file", cxxopts::value<std::string>()->default_value("results.json"))
+        ("baseline", "Baseline JSON file to compare against", cxxopts::value<std::string>())
+        ("update-baseline", "Write the results to the baseline file instead of comparing")
+        ("runs", "Repetitions per measurement", cxxopts::value<unsigned>()->default_value("5"))
+        ("filter", "Only run benchmarks whose name contains this text", cxxopts::value<std::string>())
+        ("alpha", "Significance level", cxxopts::value<double>()->default_value("0.05"))
+        ("threshold", "Minimum change in percent reported as a regression",
+            cxxopts::value<double>()->default_value("3"))
+        ("h,help", "Print usage");
+
+    const auto result = options.parse(argc, argv);
+
+    if (result.count("help") || !result.count("compiler") || !result.count("corpus")) {
+        std::cout << options.help() << std::endl;
+        return result.count("help") ? 0 : 1;
+    }
+
+    const std::string compiler = fs::absolute(result["compiler"].as<std::string>()).string();
+    const fs::path workDir = fs::absolute(result["work-dir"].as<std::string>());
+    const unsigned runs = std::max(2u, result["runs"].as<unsigned>());
+    fs::create_directories(workDir);
+
+    std::vector<fs::path> programs;
+    for (const auto& entry : fs::directory_iterator(result["corpus"].as<std::string>())) {
+        const std::string name = entry.path().stem().string();
+        if (entry.path().extension() != ".sb") continue;
+        if (result.count("filter") && name.find(result["filter"].as<std::string>()) == std::string::npos) continue;
+        programs.push_back(entry.path());
+    }
+    std::ranges::sort(programs);
+
+    std::map<std::string, Samples> results;
+    size_t failed = 0;
+    for (const auto& program : programs) {
+        const std::string name = program.stem().string();
+        const std::string executable = (workDir / name).string();
+        Samples& samples = results[name];
+
+        std::vector<std::string> compileArgs = {compiler, fs::absolute(program).string(), "-o", executable};
+        if (result.count("std-path")) {
+            compileArgs.insert(compileArgs.end(), {"--std-path", result["std-path"].as<std::string>()});
+        }
+
+        // a program that fails is recorded as such and the rest of the corpus is still measured
+        const auto fail = [&](const std::string& failure) {
+            spdlog::error("{}: {}", name, failure);
+            samples.failure = failure;
+            failed++;
+        };
+
+        spdlog::info("{}: compiling", name);
+        for (unsigned i = 0; i < runs; ++i) {
+            const ProcessResult compiled = runProcess(compileArgs, {});
+            if (compiled.exitCode != 0) {
+                fail(fmt::format("compiler exited with {}", compiled.exitCode));
+                break;
+            }
+            samples.compileMs.push_back(compiled.wallMs);
+        }
+        if (!samples.failure.empty()) continue;
+
+        std::vector<std::pair<std::string, std::string>> env;
+        const fs::path countFile = workDir / (name + ".allocations");
+        if (result.count("alloc-counter")) {
+            env = {{"LD_PRELOAD", fs::absolute(result["alloc-counter"].as<std::string>()).string()},
+                   {"SMALLBASIC_ALLOC_COUNT_FILE", countFile.string()}};
+        }
+
+        spdlog::info("{}: running", name);
+        for (unsigned i = 0; i < runs; ++i) {
+            const ProcessResult ran = runProcess({executable}, env);
+            if (ran.exitCode != 0) {
+                fail(fmt::format("program exited with {}", ran.exitCode));
+                break;
+            }
+            samples.runMs.push_back(ran.wallMs);
+            samples.peakRssKb.push_back(ran.peakRssKb);
+        }
+
+        if (std::ifstream counts(countFile); counts >> samples.allocations) {
+            fs::remove(countFile);
+        }
+    }
+
+    const llvm::json::Value json = resultsToJson(results, runs);
+    writeJson(result["output"].as<std::string>(), json);
+    spdlog::info("Results written to {}", result["output"].as<std::string>());
+    if (failed) {
+        spdlog::error("{} of {} programs failed", failed, programs.size());
+    }
+
+    const int failedExitCode = failed ? 1 : 0;
+    if (!result.count("baseline")) return failedExitCode;
+    const std::string baselinePath = result["baseline"].as<std::string>();
+
+    if (result.count("update-baseline")) {
+        writeJson(baselinePath, json);
+        spdlog::info("Baseline updated: {}", baselinePath);
+        return failedExitCode;
+    }
+
+    const auto buffer = llvm::MemoryBuffer::getFile(baselinePath);
+    if (!buffer) {
+        spdlog::warn("No baseline at {}, record one with --update-baseline", baselinePath);
+        return failedExitCode;
+    }
+
+    auto baseline = llvm::json::parse((*buffer)->getBuffer());
+    if (!baseline) {
+        spdlog::error("Invalid baseline {}: {}", baselinePath, llvm::toString(baseline.takeError()));
+        return 1;
+    }
+
+    return compare(resultsFromJson(*baseline), results, result["alpha"].as<double>(),
+                   result["threshold"].as<double>()) ? 1 : 0;
+}
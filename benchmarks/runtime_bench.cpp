@@ -0,0 +1,198 @@
+// Microbenchmarks for the runtime's extern "C" entry points, reporting ns/op and allocations/op.
+// Each benchmark frees what the entry point returns, so the cost of releasing a value is included.
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <cxxopts.hpp>
+#include <fmt/format.h>
+
+#include "../src/std/value.hpp"
+
+extern "C" unsigned long long smallbasic_allocation_count();
+
+extern "C" Primitive* clock_time_get();
+extern "C" Primitive* clock_date_get();
+extern "C" Primitive* clock_year_get();
+extern "C" Primitive* clock_hour_get();
+extern "C" Primitive* clock_millisecond_get();
+extern "C" Primitive* clock_elapsedmilliseconds_get();
+extern "C" Primitive* clock_elapsednanoseconds_get();
+
+template <typename T>
+static void doNotOptimize(const T& value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+struct Result {
+    std::string name;
+    double nsPerOp;
+    double allocsPerOp;
+};
+
+class MicroBenchmarks {
+public:
+    MicroBenchmarks(std::string filter, const double minTimeMs) : filter(std::move(filter)), minTimeMs(minTimeMs) {}
+
+    // Calibrates the iteration count to minTimeMs and reports the median of five repetitions.
+    template <typename F>
+    void run(const std::string& name, F&& op) {
+        if (!filter.empty() && name.find(filter) == std::string::npos) return;
+
+        size_t iterations = 1;
+        while (measure(op, iterations).first < minTimeMs * 1e6 / 10 && iterations < (1ull << 40)) {
+            iterations *= 2;
+        }
+        iterations = std::max<size_t>(1, iterations * 10);
+
+        std::vector<double> nsPerOp;
+        double allocsPerOp = 0;
+        for (int rep = 0; rep < 5; ++rep) {
+            const auto [ns, allocations] = measure(op, iterations);
+            nsPerOp.push_back(ns / static_cast<double>(iterations));
+            allocsPerOp = static_cast<double>(allocations) / static_cast<double>(iterations);
+        }
+        std::ranges::sort(nsPerOp);
+
+        results.push_back({name, nsPerOp[nsPerOp.size() / 2], allocsPerOp});
+        std::cout << fmt::format("{:<40} {:>12.1f} ns/op {:>8.2f} allocs/op\n",
+                                 name, results.back().nsPerOp, results.back().allocsPerOp);
+    }
+
+    void writeJson(const std::string& path) const {
+        std::ofstream out(path);
+        out << "{\n  \"benchmarks\": [\n";
+        for (size_t i = 0; i < results.size(); ++i) {
+            out << fmt::format("    {{\"name\": \"{}\", \"ns_per_op\": {:.3f}, \"allocs_per_op\": {:.3f}}}{}\n",
+                               results[i].name, results[i].nsPerOp, results[i].allocsPerOp,
+                               i + 1 < results.size() ? "," : "");
+        }
+        out << "  ]\n}\n";
+    }
+
+private:
+    std::string filter;
+    double minTimeMs;
+    std::vector<Result> results;
+
+    template <typename F>
+    static std::pair<double, unsigned long long> measure(F& op, const size_t iterations) {
+        const unsigned long long allocationsBefore = smallbasic_allocation_count();
+        const auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < iterations; ++i) {
+            op();
+        }
+        const auto elapsed = std::chrono::steady_clock::now() - start;
+        return {std::chrono::duration<double, std::nano>(elapsed).count(),
+                smallbasic_allocation_count() - allocationsBefore};
+    }
+};
+
+static Primitive makeArray(const size_t size) {
+    Primitive array;
+    for (size_t i = 1; i <= size; ++i) {
+        Primitive index(static_cast<double>(i));
+        Primitive value(static_cast<double>(i * 2));
+        array_set(&array, &index, &value);
+    }
+    return array;
+}
+
+int main(int argc, char** argv) {
+    cxxopts::Options options("SmallBasicRuntimeBenchmarks", "Microbenchmarks for the SmallBasic runtime library");
+    options.add_options()
+        ("filter", "Only run benchmarks whose name contains this text", cxxopts::value<std::string>())
+        ("min-time", "Minimum time per repetition in ms", cxxopts::value<double>()->default_value("100"))
+        ("json", "Write results to a JSON file", cxxopts::value<std::string>())
+        ("h,help", "Print usage");
+    options.parse_positional({"filter"});
+
+    const auto result = options.parse(argc, argv);
+    if (result.count("help")) {
+        std::cout << options.help() << std::endl;
+        return 0;
+    }
+
+    MicroBenchmarks bench(result.count("filter") ? result["filter"].as<std::string>() : "",
+                          result["min-time"].as<double>());
+
+    Primitive number1(1234.5);
+    Primitive number2(42.0);
+    Primitive string1(std::string("Hello, "));
+    Primitive string2(std::string("World"));
+    Primitive numericString(std::string("12345.678"));
+
+    bench.run("value_add/number+number", [&] {
+        Primitive* r = value_add(&number1, &number2);
+        doNotOptimize(r);
+        delete r;
+    });
+    bench.run("value_add/string+string", [&] {
+        Primitive* r = value_add(&string1, &string2);
+        doNotOptimize(r);
+        delete r;
+    });
+    bench.run("value_add/string+number", [&] {
+        Primitive* r = value_add(&string1, &number1);
+        doNotOptimize(r);
+        delete r;
+    });
+
+    bench.run("value_to_string/number", [&] { doNotOptimize(value_to_string(&number1)); });
+    bench.run("value_to_string/string", [&] { doNotOptimize(value_to_string(&string1)); });
+    bench.run("value_to_number/number", [&] { doNotOptimize(value_to_number(&number1)); });
+    bench.run("value_to_number/string", [&] { doNotOptimize(value_to_number(&numericString)); });
+
+    // compare_values is internal, value_eq and value_lt are the entry points reaching it
+    bench.run("value_eq/number", [&] { doNotOptimize(value_eq(&number1, &number2)); });
+    bench.run("value_eq/string", [&] { doNotOptimize(value_eq(&string1, &string2)); });
+    bench.run("value_lt/number", [&] { doNotOptimize(value_lt(&number1, &number2)); });
+    bench.run("value_lt/string-number", [&] { doNotOptimize(value_lt(&numericString, &number2)); });
+
+    for (const size_t size : {10, 100, 1000}) {
+        Primitive array = makeArray(size);
+        Primitive hit(static_cast<double>(size / 2 + 1));
+        Primitive miss(std::string("missing"));
+        Primitive value(7.0);
+
+        bench.run(fmt::format("array_get/hit/{}", size), [&] {
+            Primitive* r = array_get(&array, &hit);
+            doNotOptimize(r);
+            delete r;
+        });
+        bench.run(fmt::format("array_get/miss/{}", size), [&] {
+            Primitive* r = array_get(&array, &miss);
+            doNotOptimize(r);
+            delete r;
+        });
+        bench.run(fmt::format("array_set/existing/{}", size), [&] {
+            doNotOptimize(array_set(&array, &hit, &value));
+        });
+
+        Primitive other = array;
+        bench.run(fmt::format("value_eq/array/{}", size), [&] { doNotOptimize(value_eq(&array, &other)); });
+    }
+
+    const auto clockGetter = [&](const std::string& name, Primitive* (*getter)()) {
+        bench.run(name, [&] {
+            Primitive* r = getter();
+            doNotOptimize(r);
+            delete r;
+        });
+    };
+    clockGetter("clock_time_get", clock_time_get);
+    clockGetter("clock_date_get", clock_date_get);
+    clockGetter("clock_year_get", clock_year_get);
+    clockGetter("clock_hour_get", clock_hour_get);
+    clockGetter("clock_millisecond_get", clock_millisecond_get);
+    clockGetter("clock_elapsedmilliseconds_get", clock_elapsedmilliseconds_get);
+    clockGetter("clock_elapsednanoseconds_get", clock_elapsednanoseconds_get);
+
+    if (result.count("json")) {
+        bench.writeJson(result["json"].as<std::string>());
+    }
+    return 0;
+}
@@ -0,0 +1,195 @@
+// Generates synthetic programs of growing size along one dimension and times every compiler phase
+// on them. The exponent column is the local slope of log(time) over log(size): around 1 is linear,
+// anything well above flags a phase that won't keep up with 100k-line generated sources.
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <cxxopts.hpp>
+#include <fmt/format.h>
+#include <llvm/ADT/SmallVector.h>
+
+#include "synthetic.hpp"
+#include "../src/lexer/lexer.hpp"
+#include "../src/parser/parser.hpp"
+#include "../src/semantic/semantic.hpp"
+#include "../src/folding/folding.hpp"
+#include "../src/codegen/codegen.hpp"
+
+static const std::vector<std::string> phases = {"lex", "parse", "semantic", "fold", "codegen", "emit"};
+
+template <typename F>
+static double timeMs(F&& f) {
+    const auto start = std::chrono::steady_clock::now();
+    f();
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Runs the whole pipeline once and returns the time of each phase, or an empty map on a compile error,
+// whose diagnostics are written to errors.
+static std::map<std::string, double> compileOnce(const std::string& source, std::ostream& errors) {
+    DiagnosticReporter diag(source, "synthetic.sb", errors);
+    std::map<std::string, double> times;
+    const auto fail = [&] {
+        diag.printDiagnostics();
+        return std::map<std::string, double>{};
+    };
+
+    Lexer lexer;
+    std::vector<Token> tokens;
+    times["lex"] = timeMs([&] { tokens = lexer.tokenize(source, diag); });
+
+    // the parser pulls its tokens from a lexer, so this phase includes a second lexing pass
+    std::unique_ptr<Program> ast;
+    Lexer streamingLexer;
+    streamingLexer.start(source, diag);
+    Parser parser(streamingLexer, diag);
+    times["parse"] = timeMs([&] { ast = parser.parse(); });
+    if (!ast || diag.hasErrorsOccurred()) return fail();
+
+    SemanticAnalyzer analyzer(diag);
+    times["semantic"] = timeMs([&] { analyzer.analyze(*ast); });
+    if (diag.hasErrorsOccurred()) return fail();
+
+    ConstantFolder folder;
+    times["fold"] = timeMs([&] { folder.fold(*ast); });
+
+    CodeGenerator codegen(diag);
+    bool generated = false;
+    times["codegen"] = timeMs([&] { generated = codegen.generate(*ast, "synthetic"); });
+    if (!generated) return fail();
+
+    llvm::SmallVector<char, 0> object;
+    bool emitted = false;
+    times["emit"] = timeMs([&] { emitted = codegen.emitObject(object); });
+    if (!emitted) return fail();
+    return times;
+}
+
+static size_t& dimension(ProgramShape& shape, const std::string& name) {
+    if (name == "statements") return shape.statements;
+    if (name == "subroutines") return shape.subroutines;
+    if (name == "gotos") return shape.gotos;
+    if (name == "nesting") return shape.nesting;
+    if (name == "strings") return shape.stringLength;
+    std::cerr << "Unknown dimension: " << name << std::endl;
+    std::exit(1);
+}
+
+int main(int argc, char** argv) {
+    cxxopts::Options options("SmallBasicScaling", "Compiler phase scaling on synthetic SmallBasic programs");
+    options.add_options()
+        ("dimension", "statements, subroutines, gotos, nesting or strings",
+            cxxopts::value<std::string>()->default_value("statements"))
+        ("from", "Smallest size of the swept dimension", cxxopts::value<size_t>()->default_value("1000"))
+        ("to", "Largest size of the swept dimension", cxxopts::value<size_t>()->default_value("128000"))
+        ("factor", "Growth factor between sizes", cxxopts::value<size_t>()->default_value("2"))
+        ("statements", "Statements when not swept", cxxopts::value<size_t>()->default_value("1000"))
+        ("subroutines", "Subroutines when not swept", cxxopts::value<size_t>()->default_value("10"))
+        ("gotos", "Labels and Gotos when not swept", cxxopts::value<size_t>()->default_value("10"))
+        ("nesting", "Expression nesting depth when not swept", cxxopts::value<size_t>()->default_value("8"))
+        ("strings", "String literal length when not swept", cxxopts::value<size_t>()->default_value("64"))
+        ("runs", "Repetitions per size, the median is reported", cxxopts::value<unsigned>()->default_value("3"))
+        ("emit", "Write one program of the given shape to this file and exit", cxxopts::value<std::string>())
+        ("csv", "Also write the measurements as CSV", cxxopts::value<std::string>())
+        ("h,help", "Print usage");
+
+    const auto result = options.parse(argc, argv);
+    if (result.count("help")) {
+        std::cout << options.help() << std::endl;
+        return 0;
+    }
+
+    ProgramShape shape;
+    shape.statements = result["statements"].as<size_t>();
+    shape.subroutines = result["subroutines"].as<size_t>();
+    shape.gotos = result["gotos"].as<size_t>();
+    shape.nesting = result["nesting"].as<size_t>();
+    shape.stringLength = result["strings"].as<size_t>();
+
+    if (result.count("emit")) {
+        std::ofstream(result["emit"].as<std::string>()) << generateProgram(shape);
+        return 0;
+    }
+
+    CodeGenerator::initializeTargets();
+
+    const std::string swept = result["dimension"].as<std::string>();
+    // a sweep from 0 would never grow
+    const size_t from = std::max<size_t>(1, result["from"].as<size_t>());
+    const size_t factor = std::max<size_t>(2, result["factor"].as<size_t>());
+    const unsigned runs = std::max(1u, result["runs"].as<unsigned>());
+
+    std::ofstream csv;
+    if (result.count("csv")) {
+        csv.open(result["csv"].as<std::string>());
+        csv << swept << ",source_bytes";
+        for (const auto& phase : phases) csv << "," << phase << "_ms";
+        csv << "\n";
+    }
+
+    std::cout << fmt::format("{:>10} {:>12}", swept, "bytes");
+    for (const auto& phase : phases) std::cout << fmt::format(" {:>10} {:>5}", phase + " ms", "exp");
+    std::cout << "\n";
+
+    std::map<std::string, double> previous;
+    size_t previousSize = 0;
+    bool superLinear = false;
+
+    for (size_t size = from; size <= result["to"].as<size_t>(); size *= factor) {
+        dimension(shape, swept) = size;
+        const std::string source = generateProgram(shape);
+
+        std::map<std::string, std::vector<double>> samples;
+        for (unsigned run = 0; run < runs; ++run) {
+            std::ostringstream errors;
+            const auto times = compileOnce(source, errors);
+            if (times.empty()) {
+                std::cerr << errors.str() << "Generated program failed to compile at " << swept << "=" << size
+                          << std::endl;
+                return 1;
+            }
+            for (const auto& [phase, ms] : times) samples[phase].push_back(ms);
+        }
+
+        std::map<std::string, double> median;
+        for (auto& [phase, values] : samples) {
+            std::ranges::sort(values);
+            median[phase] = values[values.size() / 2];
+        }
+
+        std::cout << fmt::format("{:>10} {:>12}", size, source.size());
+        if (csv.is_open()) csv << size << "," << source.size();
+        for (const auto& phase : phases) {
+            std::string exponent = "";
+            // sub-millisecond phases are dominated by noise, their slope means nothing
+            if (previousSize && previous[phase] > 1 && median[phase] > 1) {
+                const double slope = std::log(median[phase] / previous[phase]) /
+                                     std::log(static_cast<double>(size) / static_cast<double>(previousSize));
+                exponent = fmt::format("{:.2f}", slope);
+                if (slope > 1.3) {
+                    exponent += "!";
+                    superLinear = true;
+                }
+            }
+            std::cout << fmt::format(" {:>10.2f} {:>5}", median[phase], exponent);
+            if (csv.is_open()) csv << "," << median[phase];
+        }
+        std::cout << "\n";
+        if (csv.is_open()) csv << "\n";
+
+        previous = median;
+        previousSize = size;
+    }
+
+    if (superLinear) {
+        std::cout << "\nPhases marked with ! grew faster than linearly in " << swept << std::endl;
+    }
+    return 0;
+}
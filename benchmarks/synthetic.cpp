@@ -0,0 +1,57 @@
+#include "synthetic.hpp"
+#include <fmt/format.h>
+#include <algorithm>
+
+static std::string nestedExpression(const size_t depth) {
+    std::string expr = "x";
+    static constexpr const char* operators[] = {" + ", " * ", " - ", " / "};
+    for (size_t i = 0; i < depth; ++i) {
+        expr = fmt::format("({}{}{})", expr, operators[i % 4], i % 7 + 1);
+    }
+    return expr;
+}
+
+std::string generateProgram(const ProgramShape& shape) {
+    std::string out;
+    out.reserve(shape.statements * 32 + shape.stringLength);
+
+    out += "' generated by SmallBasicScaling\n";
+    out += "x = 1\ntotal = 0\n";
+    out += fmt::format("text = \"{}\"\n", std::string(shape.stringLength, 'a'));
+    out += fmt::format("deep = {}\n", nestedExpression(shape.nesting));
+
+    for (size_t s = 0; s < shape.subroutines; ++s) {
+        out += fmt::format("Sub Routine{}\n  total = total + {}\n  x = x * 2 - total\nEndSub\n", s, s);
+    }
+
+    // labels are spread evenly through the statements; every Goto is guarded by a condition
+    // that never holds, so the program still runs straight through when executed
+    const size_t labelEvery = shape.gotos ? std::max<size_t>(1, shape.statements / shape.gotos) : 0;
+    size_t labels = 0;
+
+    for (size_t i = 0; i < shape.statements; ++i) {
+        if (labelEvery && i % labelEvery == 0 && labels < shape.gotos) {
+            out += fmt::format("Label{}:\n", labels);
+            out += fmt::format("If total < 0 Then\n  Goto Label{}\nEndIf\n", (labels * 7919) % (labels + 1));
+            ++labels;
+        }
+
+        switch (i % 6) {
+            case 0: out += fmt::format("v{} = x + {} * total\n", i % 97, i); break;
+            case 1: out += fmt::format("If x > {} Then\n  total = total + 1\nElse\n  total = total - 1\nEndIf\n", i); break;
+            case 2: out += fmt::format("For i = 1 To 3\n  arr[i][{}] = i + {}\nEndFor\n", i % 13, i); break;
+            case 3: out += fmt::format("s{} = \"item \" + {} + text\n", i % 31, i); break;
+            case 4:
+                if (shape.subroutines) {
+                    out += fmt::format("Routine{}()\n", i % shape.subroutines);
+                } else {
+                    out += "x = x + 1\n";
+                }
+                break;
+            default: out += fmt::format("While total > {}\n  total = total - 1\nEndWhile\n", i * 1000); break;
+        }
+    }
+
+    out += "TextWindow.WriteLine(total)\n";
+    return out;
+}
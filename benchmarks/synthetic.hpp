@@ -0,0 +1,16 @@
+#pragma once
+#include <cstddef>
+#include <string>
+
+// Size of a generated program along each dimension the scaling harness sweeps.
+struct ProgramShape {
+    size_t statements = 1000;
+    size_t subroutines = 10;
+    size_t gotos = 10;
+    size_t nesting = 8;
+    size_t stringLength = 64;
+};
+
+// Emits a valid SmallBasic program of the given shape. The output is deterministic so
+// timings of the same shape are comparable between runs and machines.
+std::string generateProgram(const ProgramShape& shape);
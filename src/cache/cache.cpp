@@ -0,0 +1,122 @@
+#include "cache.hpp"
+#include "../codegen/codegen.hpp"
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/SHA256.h>
+#include <llvm/ADT/StringExtras.h>
+#include <llvm/TargetParser/Host.h>
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <thread>
+
+CompilationCache::CompilationCache(std::filesystem::path dir, const uintmax_t maxSize)
+    : directory(std::move(dir)), maxSize(maxSize) {
+    std::error_code ec;
+    std::filesystem::create_directories(directory, ec);
+}
+
+std::string CompilationCache::computeKey(const std::string_view source, const std::string& stdPath,
+                                         const std::vector<std::string>& flags) {
+    llvm::SHA256 hasher;
+
+    // every field is NUL-terminated so adjacent values can't run into each other
+    const auto add = [&hasher](const llvm::StringRef value) {
+        hasher.update(value);
+        hasher.update(llvm::StringRef("\0", 1));
+    };
+
+    add(VERSION);
+    add(llvm::sys::getDefaultTargetTriple());
+    add(CodeGenerator::targetCPU);
+    add(CodeGenerator::targetFeatures);
+    for (const auto& flag : flags) {
+        add(flag);
+    }
+
+    if (auto library = llvm::MemoryBuffer::getFile(stdPath)) {
+        add((*library)->getBuffer());
+    } else {
+        add(stdPath);
+    }
+
+    add(source);
+
+    return llvm::toHex(hasher.final(), true);
+}
+
+bool CompilationCache::fetch(const std::string& key, const std::string& output) const {
+    const auto entry = directory / key;
+
+    std::error_code ec;
+    if (!std::filesystem::exists(entry, ec)) {
+        spdlog::info("Cache miss: {}", key.substr(0, 16));
+        return false;
+    }
+
+    std::filesystem::copy_file(entry, output, std::filesystem::copy_options::overwrite_existing, ec);
+    if (ec) {
+        spdlog::warn("Cache entry {} could not be copied: {}", key.substr(0, 16), ec.message());
+        return false;
+    }
+
+    // the modification time doubles as the LRU timestamp
+    std::filesystem::last_write_time(entry, std::filesystem::file_time_type::clock::now(), ec);
+
+    spdlog::info("Cache hit: {}", key.substr(0, 16));
+    return true;
+}
+
+size_t CompilationCache::store(const std::string& key, const std::string& output) const {
+    const auto entry = directory / key;
+    // batch workers may store the same key concurrently, each stages its own copy
+    const auto staging = directory / (key + "." + std::to_string(std::hash<std::thread::id>{}(std::this_thread::get_id())) + ".tmp");
+
+    std::error_code ec;
+    std::filesystem::copy_file(output, staging, std::filesystem::copy_options::overwrite_existing, ec);
+    if (!ec) {
+        std::filesystem::rename(staging, entry, ec);
+    }
+
+    if (ec) {
+        spdlog::warn("Could not store cache entry {}: {}", key.substr(0, 16), ec.message());
+        std::filesystem::remove(staging, ec);
+        return 0;
+    }
+
+    return evict();
+}
+
+size_t CompilationCache::evict() const {
+    struct Entry {
+        std::filesystem::path path;
+        std::filesystem::file_time_type lastUse;
+        uintmax_t size;
+    };
+
+    std::vector<Entry> entries;
+    uintmax_t totalSize = 0;
+
+    std::error_code ec;
+    for (const auto& file : std::filesystem::directory_iterator(directory, ec)) {
+        if (!file.is_regular_file(ec) || file.path().extension() == ".tmp") continue;
+
+        const uintmax_t size = file.file_size(ec);
+        entries.push_back({file.path(), file.last_write_time(ec), size});
+        totalSize += size;
+    }
+
+    if (totalSize <= maxSize) return 0;
+
+    std::ranges::sort(entries, {}, &Entry::lastUse);
+
+    size_t evicted = 0;
+    for (const auto& entry : entries) {
+        if (totalSize <= maxSize) break;
+        if (std::filesystem::remove(entry.path, ec)) {
+            totalSize -= entry.size;
+            evicted++;
+        }
+    }
+
+    spdlog::info("Cache evicted {} entr{} ({} bytes in use)", evicted, evicted == 1 ? "y" : "ies", totalSize);
+    return evicted;
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Stores linked executables under a content hash of everything that affects them,
+// evicting the least recently used entries once the directory exceeds maxSize bytes.
+class CompilationCache {
+public:
+    CompilationCache(std::filesystem::path dir, uintmax_t maxSize);
+
+    static std::string computeKey(std::string_view source, const std::string& stdPath,
+                                  const std::vector<std::string>& flags);
+
+    bool fetch(const std::string& key, const std::string& output) const;
+    // Returns the number of entries evicted to make room.
+    size_t store(const std::string& key, const std::string& output) const;
+
+private:
+    std::filesystem::path directory;
+    uintmax_t maxSize;
+
+    size_t evict() const;
+};
@@ -3,6 +3,9 @@
 #include <llvm/Support/FileSystem.h>
 #include <llvm/Support/raw_ostream.h>
 #include <llvm/IR/LegacyPassManager.h>
+#include <llvm/Passes/PassBuilder.h>
+#include <llvm/Support/PGOOptions.h>
+#include <llvm/Support/VirtualFileSystem.h>
 #include <llvm/MC/TargetRegistry.h>
 #include <llvm/Support/TargetSelect.h>
 #include <llvm/Target/TargetMachine.h>
@@ -12,11 +15,14 @@
 #include <algorithm>
 #include <cctype>
 #include <filesystem>
+#include <mutex>
+#include <optional>
 
-#define CAST(Type, var, expr) auto var = dynamic_cast<Type*>(expr)
+#define CAST(Type, var, expr) auto var = nodeCast<Type>(expr)
 
 CodeGenerator::CodeGenerator(DiagnosticReporter& diag)
     : reporter(diag),
+      program(nullptr),
       context(std::make_unique<llvm::LLVMContext>()),
       module(nullptr),
       builder(nullptr),
@@ -24,6 +30,11 @@ CodeGenerator::CodeGenerator(DiagnosticReporter& diag)
       currentBlock(nullptr) {}
 
 bool CodeGenerator::generate(const Program& program, const std::string& moduleName) {
+    this->program = &program;
+    variables.assign(program.symbols.foldedSize(), nullptr);
+    sharedVariables.assign(program.symbols.foldedSize(), false);
+    subroutines.assign(program.symbols.foldedSize(), nullptr);
+    labels.assign(program.symbols.size(), nullptr);
     module = std::make_unique<llvm::Module>(moduleName, *context);
     builder = std::make_unique<llvm::IRBuilder<>>(*context);
 
@@ -38,18 +49,43 @@ bool CodeGenerator::generate(const Program& program, const std::string& moduleNa
 
     declareRuntimeFunctions();
 
+    if (profileCounts) {
+        // the final array size is only known once every statement has been generated
+        profileCounters = new llvm::GlobalVariable(*module, i64Ty, false, llvm::GlobalValue::PrivateLinkage,
+            llvm::ConstantInt::get(i64Ty, 0), "profile_counters_placeholder");
+    }
+
+    if (profileSampling) {
+        profileCurrentSite = new llvm::GlobalVariable(*module, i32Ty, false, llvm::GlobalValue::ExternalLinkage,
+            nullptr, "profile_current_site");
+        profileEnter = llvm::Function::Create(llvm::FunctionType::get(voidTy, {}, false),
+            llvm::Function::ExternalLinkage, "profile_enter", module.get());
+        profileLeave = llvm::Function::Create(llvm::FunctionType::get(voidTy, {}, false),
+            llvm::Function::ExternalLinkage, "profile_leave", module.get());
+    }
+
     for (const auto& stmt : program.statements) {
-        if (CAST(LabelStatement, labelStmt, stmt.get())) {
-            labels[labelStmt->name] = createBlock("label_" + labelStmt->name);
-        } else if (CAST(SubroutineStatement, subStmt, stmt.get())) {
-            generateSubroutine(*subStmt);
+        if (CAST(SubroutineStatement, subStmt, stmt)) {
+            for (const auto& s : subStmt->body) {
+                findSharedVariables(*s);
+            }
         }
     }
 
+    // labels are blocks of main, which must exist before a Goto can branch to one
     createMainFunction();
 
     for (const auto& stmt : program.statements) {
-        if (!dynamic_cast<SubroutineStatement*>(stmt.get())) {
+        if (CAST(LabelStatement, labelStmt, stmt)) {
+            labels[labelStmt->name] = llvm::BasicBlock::Create(*context, "label_" + program.name(labelStmt->name),
+                                                               mainFunction);
+        } else if (CAST(SubroutineStatement, subStmt, stmt)) {
+            generateSubroutine(*subStmt);
+        }
+    }
+
+    for (const auto& stmt : program.statements) {
+        if (stmt->kind != NodeKind::SubroutineStatement) {
             generateStatement(*stmt);
         }
     }
@@ -57,6 +93,10 @@ bool CodeGenerator::generate(const Program& program, const std::string& moduleNa
     builder->CreateCall(runtimeCleanup);
     builder->CreateRet(llvm::ConstantInt::get(i32Ty, 0));
 
+    if (profileCounts || profileSampling) {
+        finalizeProfile();
+    }
+
     std::string errorStr;
     llvm::raw_string_ostream errorStream(errorStr);
     if (llvm::verifyModule(*module, &errorStream)) {
@@ -195,25 +235,117 @@ void CodeGenerator::createMainFunction() {
 
     auto argc = mainFunction->getArg(0);
     auto argv = mainFunction->getArg(1);
-    builder->CreateCall(runtimeInit, {argc, argv});
+    runtimeInitCall = builder->CreateCall(runtimeInit, {argc, argv});
+}
+
+void CodeGenerator::enableProfileCounts(const std::string& sourcePath) {
+    profileCounts = true;
+    profileSource = sourcePath;
+}
+
+void CodeGenerator::enableProfileSampling(const std::string& sourcePath) {
+    profileSampling = true;
+    profileSource = sourcePath;
+}
+
+void CodeGenerator::emitProfileSite(const ASTNode& node) {
+    if (!profileCounts && !profileSampling) return;
+
+    const uint64_t index = profileSites.size();
+    const SourceLocation location = program->location(node);
+    profileSites.push_back({location.line, location.column, profileFunction});
+
+    if (profileCounts) {
+        // programs are single threaded, relaxed load/store avoids a locked read-modify-write
+        llvm::Value* counter = builder->CreateConstInBoundsGEP1_64(i64Ty, profileCounters, index);
+        llvm::LoadInst* count = builder->CreateAlignedLoad(i64Ty, counter, llvm::Align(8));
+        count->setAtomic(llvm::AtomicOrdering::Monotonic);
+        llvm::Value* next = builder->CreateAdd(count, llvm::ConstantInt::get(i64Ty, 1));
+        llvm::StoreInst* store = builder->CreateAlignedStore(next, counter, llvm::Align(8));
+        store->setAtomic(llvm::AtomicOrdering::Monotonic);
+    }
+
+    if (profileSampling) {
+        // read by the SIGPROF handler, so it must not be merged away between statements
+        builder->CreateStore(llvm::ConstantInt::get(i32Ty, index), profileCurrentSite, true);
+    }
+}
+
+void CodeGenerator::finalizeProfile() {
+    llvm::Constant* counters = llvm::ConstantPointerNull::get(i8PtrTy);
+    if (profileCounts) {
+        auto* countersTy = llvm::ArrayType::get(i64Ty, profileSites.size());
+        auto* countersArray = new llvm::GlobalVariable(*module, countersTy, false, llvm::GlobalValue::PrivateLinkage,
+            llvm::ConstantAggregateZero::get(countersTy), "profile_counters");
+        profileCounters->replaceAllUsesWith(countersArray);
+        profileCounters->eraseFromParent();
+        profileCounters = countersArray;
+        counters = countersArray;
+    }
+
+    // flattened (line, column, function) triples, indexed like the counters
+    std::vector<llvm::Constant*> sites;
+    sites.reserve(profileSites.size() * 3);
+    for (const auto& [line, column, function] : profileSites) {
+        sites.push_back(llvm::ConstantInt::get(i32Ty, line));
+        sites.push_back(llvm::ConstantInt::get(i32Ty, column));
+        sites.push_back(llvm::ConstantInt::get(i32Ty, function));
+    }
+
+    auto* sitesTy = llvm::ArrayType::get(i32Ty, sites.size());
+    auto* sitesTable = new llvm::GlobalVariable(*module, sitesTy, true, llvm::GlobalValue::PrivateLinkage,
+        llvm::ConstantArray::get(sitesTy, sites), "profile_sites");
+
+    std::vector<llvm::Constant*> functions;
+    functions.reserve(profileFunctions.size());
+    for (const auto& name : profileFunctions) {
+        functions.push_back(builder->CreateGlobalString(name, "profile_function", 0, module.get()));
+    }
+
+    auto* functionsTy = llvm::ArrayType::get(i8PtrTy, functions.size());
+    auto* functionsTable = new llvm::GlobalVariable(*module, functionsTy, true, llvm::GlobalValue::PrivateLinkage,
+        llvm::ConstantArray::get(functionsTy, functions), "profile_functions");
+
+    // void profile_register(uint64_t* counters, const uint32_t* sites, uint32_t siteCount,
+    //                       const char** functions, uint32_t functionCount, const char* source)
+    llvm::Function* profileRegister = llvm::Function::Create(
+        llvm::FunctionType::get(voidTy, {i8PtrTy, i8PtrTy, i32Ty, i8PtrTy, i32Ty, i8PtrTy}, false),
+        llvm::Function::ExternalLinkage,
+        "profile_register",
+        module.get()
+    );
+
+    builder->SetInsertPoint(runtimeInitCall->getNextNode());
+    builder->CreateCall(profileRegister, {
+        counters, sitesTable,
+        llvm::ConstantInt::get(i32Ty, profileSites.size()),
+        functionsTable,
+        llvm::ConstantInt::get(i32Ty, functions.size()),
+        createStringConstant(profileSource)
+    });
+
+    if (profileSampling) {
+        llvm::Function* profileStart = llvm::Function::Create(llvm::FunctionType::get(voidTy, {}, false),
+            llvm::Function::ExternalLinkage, "profile_start", module.get());
+        builder->CreateCall(profileStart);
+    }
 }
 
 void CodeGenerator::generateStatement(Statement& stmt) {
-    if (CAST(AssignmentStatement, assignStmt, &stmt)) {
-        generateAssignment(*assignStmt);
-    } else if (CAST(ExpressionStatement, exprStmt, &stmt)) {
-        generateExpressionStmt(*exprStmt);
-    } else if (CAST(IfStatement, ifStmt, &stmt)) {
-        generateIf(*ifStmt);
-    } else if (CAST(WhileStatement, whileStmt, &stmt)) {
-        generateWhile(*whileStmt);
-    } else if (CAST(ForStatement, forStmt, &stmt)) {
-        generateFor(*forStmt);
-    } else if (CAST(GotoStatement, gotoStmt, &stmt)) {
-        generateGoto(*gotoStmt);
-    } else if (CAST(LabelStatement, labelStmt, &stmt)) {
-        generateLabel(*labelStmt);
+    if (stmt.kind != NodeKind::LabelStatement) {
+        emitProfileSite(stmt);
     }
+
+    visit(stmt, Overloaded{
+        [&](AssignmentStatement& assignStmt) { generateAssignment(assignStmt); },
+        [&](ExpressionStatement& exprStmt) { generateExpressionStmt(exprStmt); },
+        [&](IfStatement& ifStmt) { generateIf(ifStmt); },
+        [&](WhileStatement& whileStmt) { generateWhile(whileStmt); },
+        [&](ForStatement& forStmt) { generateFor(forStmt); },
+        [&](GotoStatement& gotoStmt) { generateGoto(gotoStmt); },
+        [&](LabelStatement& labelStmt) { generateLabel(labelStmt); },
+        [](SubroutineStatement&) {}, // emitted up front by generate()
+    });
 }
 
 void CodeGenerator::generateAssignment(AssignmentStatement& stmt) {
@@ -222,28 +354,34 @@ void CodeGenerator::generateAssignment(AssignmentStatement& stmt) {
 }
 
 void CodeGenerator::generateAssignmentTarget(Expression& target, llvm::Value* value) {
-    if (CAST(Identifier, ident, &target)) {
-        assignToVariable(ident->name, value);
-    } else if (CAST(ArrayAccess, arrAccess, &target)) {
-        assignToArray(*arrAccess, value);
-    } else if (CAST(PropertyAccess, propAccess, &target)) {
-        assignToProperty(*propAccess, value);
+    switch (target.kind) {
+        case NodeKind::Identifier:
+            assignToVariable(static_cast<Identifier&>(target).name, value);
+            break;
+        case NodeKind::ArrayAccess:
+            assignToArray(static_cast<ArrayAccess&>(target), value);
+            break;
+        case NodeKind::PropertyAccess:
+            assignToProperty(static_cast<PropertyAccess&>(target), value);
+            break;
+        default:
+            break;
     }
 }
 
-void CodeGenerator::assignToVariable(const std::string& name, llvm::Value* value) {
-    llvm::GlobalVariable* var = getOrCreateVariable(name);
+void CodeGenerator::assignToVariable(const SymbolId name, llvm::Value* value) {
+    llvm::Value* var = getOrCreateVariable(name);
     builder->CreateStore(value, var);
 }
 
 void CodeGenerator::assignToArray(const ArrayAccess& access, llvm::Value* value) {
-    if (CAST(Identifier, ident, access.array.get())) {
-        llvm::GlobalVariable* arrayVar = getOrCreateVariable(ident->name);
+    if (CAST(Identifier, ident, access.array)) {
+        llvm::Value* arrayVar = getOrCreateVariable(ident->name);
         llvm::Value* array = builder->CreateLoad(valuePtrTy, arrayVar);
         llvm::Value* index = generateExpression(*access.index);
         llvm::Value* newArray = builder->CreateCall(arraySet, {array, index, value});
         builder->CreateStore(newArray, arrayVar);
-    } else if (CAST(ArrayAccess, nestedAccess, access.array.get())) {
+    } else if (CAST(ArrayAccess, nestedAccess, access.array)) {
         assignToNestedArray(access, value);
     } else {
         llvm::Value* array = generateExpression(*access.array);
@@ -253,15 +391,11 @@ void CodeGenerator::assignToArray(const ArrayAccess& access, llvm::Value* value)
 }
 
 void CodeGenerator::assignToProperty(const PropertyAccess& access, llvm::Value* value) {
-    if (CAST(Identifier, objIdent, access.object.get())) {
-        const std::string& objName = objIdent->name;
-        const std::string& propName = access.property;
-        if (registry.hasProperty(objName, propName)) {
-            std::string objLower = objName;
-            std::string propLower = propName;
-            std::ranges::transform(objLower, objLower.begin(), ::tolower);
-            std::ranges::transform(propLower, propLower.begin(), ::tolower);
-            const std::string symbol = objLower + "_" + propLower + "_set";
+    if (CAST(Identifier, objIdent, access.object)) {
+        const std::string_view objName = program->symbols.name(objIdent->name);
+        const std::string_view propName = program->symbols.name(access.property);
+        if (const auto* entry = registry.findProperty(objName, propName)) {
+            const llvm::StringRef symbol = entry->setter.view();
 
             llvm::Function* fn = module->getFunction(symbol);
             if (!fn) {
@@ -280,12 +414,12 @@ void CodeGenerator::assignToNestedArray(const ArrayAccess& access, llvm::Value*
     
     const ArrayAccess* current = &access;
     while (current) {
-        indices.push_back(current->index.get());
+        indices.push_back(current->index);
         
-        if (CAST(ArrayAccess, nextAccess, current->array.get())) {
+        if (CAST(ArrayAccess, nextAccess, current->array)) {
             current = nextAccess;
         } else {
-            root = current->array.get();
+            root = current->array;
             current = nullptr;
         }
     }
@@ -293,7 +427,7 @@ void CodeGenerator::assignToNestedArray(const ArrayAccess& access, llvm::Value*
     std::ranges::reverse(indices);
 
     if (CAST(Identifier, rootIdent, root)) {
-        llvm::GlobalVariable* rootVar = getOrCreateVariable(rootIdent->name);
+        llvm::Value* rootVar = getOrCreateVariable(rootIdent->name);
         llvm::Value* rootArray = builder->CreateLoad(valuePtrTy, rootVar);
 
         std::vector<llvm::Value*> intermediateArrays;
@@ -325,51 +459,39 @@ void CodeGenerator::generateExpressionStmt(const ExpressionStatement& stmt) {
 }
 
 void CodeGenerator::generateIf(IfStatement& stmt) {
-    llvm::Value* condition = generateExpression(*stmt.condition);
-    llvm::Value* condNum = builder->CreateCall(valueToNumber, {condition});
-    llvm::Value* cond = builder->CreateFCmpONE(condNum,
-        llvm::ConstantFP::get(doubleTy, 0.0));
-
     llvm::BasicBlock* thenBlock = createBlock("if_then");
     llvm::BasicBlock* elseBlock = createBlock("if_else");
     llvm::BasicBlock* mergeBlock = createBlock("if_merge");
 
-    builder->CreateCondBr(cond, thenBlock, elseBlock);
+    generateBranch(*stmt.condition, thenBlock, elseBlock);
 
     // Then block
     builder->SetInsertPoint(thenBlock);
     for (const auto& s : stmt.thenBlock) {
         generateStatement(*s);
     }
-    if (!thenBlock->getTerminator()) {
+    if (!builder->GetInsertBlock()->getTerminator()) {
         builder->CreateBr(mergeBlock);
     }
 
     // ElseIf and Else blocks
     builder->SetInsertPoint(elseBlock);
-    llvm::BasicBlock* nextElseBlock = elseBlock;
-    
-    for (const auto& [elseIfCond, elseIfBlock] : stmt.elseIfBlocks) {
-        llvm::Value* elseIfCondVal = generateExpression(*elseIfCond);
-        llvm::Value* elseIfCondNum = builder->CreateCall(valueToNumber, {elseIfCondVal});
-        llvm::Value* elseIfCmp = builder->CreateFCmpONE(elseIfCondNum,
-            llvm::ConstantFP::get(doubleTy, 0.0));
 
+    for (const auto& [elseIfCond, elseIfBlock] : stmt.elseIfBlocks) {
         llvm::BasicBlock* elseIfThen = createBlock("elseif_then");
         llvm::BasicBlock* nextElse = createBlock("elseif_next");
 
-        builder->CreateCondBr(elseIfCmp, elseIfThen, nextElse);
+        generateBranch(*elseIfCond, elseIfThen, nextElse);
 
         builder->SetInsertPoint(elseIfThen);
         for (const auto& s : elseIfBlock) {
             generateStatement(*s);
         }
-        if (!elseIfThen->getTerminator()) {
+        if (!builder->GetInsertBlock()->getTerminator()) {
             builder->CreateBr(mergeBlock);
         }
 
         builder->SetInsertPoint(nextElse);
-        nextElseBlock = nextElse;
     }
 
     if (!stmt.elseBlock.empty()) {
@@ -377,7 +499,7 @@ void CodeGenerator::generateIf(IfStatement& stmt) {
             generateStatement(*s);
         }
     }
-    if (!nextElseBlock->getTerminator()) {
+    if (!builder->GetInsertBlock()->getTerminator()) {
         builder->CreateBr(mergeBlock);
     }
 
@@ -392,13 +514,7 @@ void CodeGenerator::generateWhile(WhileStatement& stmt) {
 
     builder->CreateBr(condBlock);
     builder->SetInsertPoint(condBlock);
-
-    llvm::Value* condition = generateExpression(*stmt.condition);
-    llvm::Value* condNum = builder->CreateCall(valueToNumber, {condition});
-    llvm::Value* cond = builder->CreateFCmpONE(condNum,
-        llvm::ConstantFP::get(doubleTy, 0.0));
-
-    builder->CreateCondBr(cond, bodyBlock, endBlock);
+    generateBranch(*stmt.condition, bodyBlock, endBlock);
 
     builder->SetInsertPoint(bodyBlock);
     for (const auto& s : stmt.body) {
@@ -422,7 +538,7 @@ void CodeGenerator::generateFor(ForStatement& stmt) {
             {llvm::ConstantFP::get(doubleTy, 1.0)});
     }
 
-    llvm::GlobalVariable* loopVar = getOrCreateVariable(stmt.variable);
+    llvm::Value* loopVar = getOrCreateVariable(stmt.variable);
     builder->CreateStore(startVal, loopVar);
 
     llvm::BasicBlock* condBlock = createBlock("for_cond");
@@ -461,8 +577,8 @@ void CodeGenerator::generateFor(ForStatement& stmt) {
 }
 
 void CodeGenerator::generateGoto(GotoStatement& stmt) {
-    if (labels.contains(stmt.label)) {
-        builder->CreateBr(labels[stmt.label]);
+    if (llvm::BasicBlock* target = labels[stmt.label]) {
+        builder->CreateBr(target);
         
 
         llvm::BasicBlock* unreachable = createBlock("after_goto");
@@ -474,7 +590,7 @@ void CodeGenerator::generateGoto(GotoStatement& stmt) {
 void CodeGenerator::generateLabel(LabelStatement& stmt) {
     llvm::BasicBlock* labelBlock = labels[stmt.name];
     
-    if (!currentBlock->getTerminator()) {
+    if (!builder->GetInsertBlock()->getTerminator()) {
         builder->CreateBr(labelBlock);
     }
     
@@ -483,17 +599,16 @@ void CodeGenerator::generateLabel(LabelStatement& stmt) {
 }
 
 void CodeGenerator::generateSubroutine(SubroutineStatement& stmt) {
-    std::string nameLower = stmt.name;
-    std::ranges::transform(nameLower, nameLower.begin(), ::tolower);
-    
+    const FoldedId key = program->symbols.folded(stmt.name);
+
     llvm::Function* subFunc = llvm::Function::Create(
         llvm::FunctionType::get(voidTy, {}, false),
         llvm::Function::InternalLinkage,
-        "sub_" + nameLower,
+        "sub_" + llvm::Twine(program->symbols.foldedName(key)),
         module.get()
     );
 
-    subroutines[nameLower] = subFunc;
+    subroutines[key] = subFunc;
 
     llvm::BasicBlock* savedBlock = currentBlock;
     const auto savedBuilder = builder->saveIP();
@@ -501,39 +616,43 @@ void CodeGenerator::generateSubroutine(SubroutineStatement& stmt) {
     llvm::BasicBlock* subEntry = llvm::BasicBlock::Create(*context, "entry", subFunc);
     builder->SetInsertPoint(subEntry);
 
+    const uint32_t savedProfileFunction = profileFunction;
+    if (profileCounts || profileSampling) {
+        profileFunction = profileFunctions.size();
+        profileFunctions.push_back(program->name(stmt.name));
+    }
+    if (profileSampling) {
+        builder->CreateCall(profileEnter);
+    }
+    emitProfileSite(stmt);
+
     for (const auto& s : stmt.body) {
         generateStatement(*s);
     }
 
-    if (!subEntry->getTerminator()) {
+    if (!builder->GetInsertBlock()->getTerminator()) {
+        if (profileSampling) {
+            builder->CreateCall(profileLeave);
+        }
         builder->CreateRetVoid();
     }
 
+    profileFunction = savedProfileFunction;
     builder->restoreIP(savedBuilder);
     currentBlock = savedBlock;
 }
 
 llvm::Value* CodeGenerator::generateExpression(Expression& expr) {
-    if (CAST(NumberLiteral, numLit, &expr)) {
-        return generateNumberLiteral(*numLit);
-    } else if (CAST(StringLiteral, strLit, &expr)) {
-        return generateStringLiteral(*strLit);
-    } else if (CAST(Identifier, ident, &expr)) {
-        return generateIdentifier(*ident);
-    } else if (CAST(BinaryExpression, binExpr, &expr)) {
-        return generateBinaryExpr(*binExpr);
-    } else if (CAST(UnaryExpression, unExpr, &expr)) {
-        return generateUnaryExpr(*unExpr);
-    } else if (CAST(CallExpression, callExpr, &expr)) {
-        return generateCallExpr(*callExpr);
-    } else if (CAST(ArrayAccess, arrAccess, &expr)) {
-        return generateArrayAccess(*arrAccess);
-    } else if (CAST(PropertyAccess, propAccess, &expr)) {
-        return generatePropertyAccess(*propAccess);
-    }
-
-    return builder->CreateCall(valueFromNumber,
-        {llvm::ConstantFP::get(doubleTy, 0.0)});
+    return visit(expr, Overloaded{
+        [&](NumberLiteral& numLit) { return generateNumberLiteral(numLit); },
+        [&](StringLiteral& strLit) { return generateStringLiteral(strLit); },
+        [&](Identifier& ident) { return generateIdentifier(ident); },
+        [&](BinaryExpression& binExpr) { return generateBinaryExpr(binExpr); },
+        [&](UnaryExpression& unExpr) { return generateUnaryExpr(unExpr); },
+        [&](CallExpression& callExpr) { return generateCallExpr(callExpr); },
+        [&](ArrayAccess& arrAccess) { return generateArrayAccess(arrAccess); },
+        [&](PropertyAccess& propAccess) { return generatePropertyAccess(propAccess); },
+    });
 }
 
 llvm::Value* CodeGenerator::generateNumberLiteral(NumberLiteral& expr) {
@@ -543,15 +662,81 @@ llvm::Value* CodeGenerator::generateNumberLiteral(NumberLiteral& expr) {
 
 llvm::Value* CodeGenerator::generateStringLiteral(StringLiteral& expr) {
     return builder->CreateCall(valueFromString,
-        {createStringConstant(expr.value)});
+        {createStringConstant(std::string(expr.value))});
 }
 
 llvm::Value* CodeGenerator::generateIdentifier(Identifier& expr) {
-    llvm::GlobalVariable* var = getOrCreateVariable(expr.name);
+    llvm::Value* var = getOrCreateVariable(expr.name);
     return builder->CreateLoad(valuePtrTy, var);
 }
 
+// Branches on the truth of a condition the way If and While test it: a comparison tests the
+// runtime's result directly instead of boxing it, and And/Or only evaluate their right operand
+// when the left one does not already decide the result.
+void CodeGenerator::generateBranch(Expression& cond, llvm::BasicBlock* ifTrue, llvm::BasicBlock* ifFalse) {
+    CAST(BinaryExpression, binExpr, &cond);
+    const BinaryOp op = binExpr ? binExpr->op : BinaryOp::Add;
+
+    if (op == BinaryOp::And || op == BinaryOp::Or) {
+        llvm::BasicBlock* rightBlock = createBlock(op == BinaryOp::And ? "and_rhs" : "or_rhs");
+        if (op == BinaryOp::And) {
+            generateBranch(*binExpr->left, rightBlock, ifFalse);
+        } else {
+            generateBranch(*binExpr->left, ifTrue, rightBlock);
+        }
+
+        builder->SetInsertPoint(rightBlock);
+        currentBlock = rightBlock;
+        generateBranch(*binExpr->right, ifTrue, ifFalse);
+        return;
+    }
+
+    llvm::Function* compare = nullptr;
+    switch (op) {
+        case BinaryOp::Equal: compare = valueEq; break;
+        case BinaryOp::NotEqual: compare = valueNeq; break;
+        case BinaryOp::LessThan: compare = valueLt; break;
+        case BinaryOp::GreaterThan: compare = valueGt; break;
+        case BinaryOp::LessThanOrEqual: compare = valueLte; break;
+        case BinaryOp::GreaterThanOrEqual: compare = valueGte; break;
+        default: break;
+    }
+
+    llvm::Value* truth;
+    if (compare) {
+        llvm::Value* left = generateExpression(*binExpr->left);
+        llvm::Value* right = generateExpression(*binExpr->right);
+        llvm::Value* cmp = builder->CreateCall(compare, {left, right});
+        truth = builder->CreateICmpNE(cmp, llvm::ConstantInt::get(i32Ty, 0));
+    } else {
+        llvm::Value* condNum = builder->CreateCall(valueToNumber, {generateExpression(cond)});
+        truth = builder->CreateFCmpONE(condNum, llvm::ConstantFP::get(doubleTy, 0.0));
+    }
+    builder->CreateCondBr(truth, ifTrue, ifFalse);
+}
+
 llvm::Value* CodeGenerator::generateBinaryExpr(BinaryExpression& expr) {
+    if (expr.op == BinaryOp::And || expr.op == BinaryOp::Or) {
+        // short-circuits like a condition, then boxes the outcome as 1 or 0
+        llvm::BasicBlock* trueBlock = createBlock("bool_true");
+        llvm::BasicBlock* falseBlock = createBlock("bool_false");
+        llvm::BasicBlock* mergeBlock = createBlock("bool_merge");
+
+        generateBranch(expr, trueBlock, falseBlock);
+
+        builder->SetInsertPoint(trueBlock);
+        builder->CreateBr(mergeBlock);
+        builder->SetInsertPoint(falseBlock);
+        builder->CreateBr(mergeBlock);
+
+        builder->SetInsertPoint(mergeBlock);
+        currentBlock = mergeBlock;
+        llvm::PHINode* resultNum = builder->CreatePHI(doubleTy, 2);
+        resultNum->addIncoming(llvm::ConstantFP::get(doubleTy, 1.0), trueBlock);
+        resultNum->addIncoming(llvm::ConstantFP::get(doubleTy, 0.0), falseBlock);
+        return builder->CreateCall(valueFromNumber, {resultNum});
+    }
+
     llvm::Value* left = generateExpression(*expr.left);
     llvm::Value* right = generateExpression(*expr.right);
 
@@ -598,28 +783,9 @@ llvm::Value* CodeGenerator::generateBinaryExpr(BinaryExpression& expr) {
             llvm::Value* dblVal = builder->CreateSIToFP(cmp, doubleTy);
             return builder->CreateCall(valueFromNumber, {dblVal});
         }
-        case BinaryOp::And: {
-            llvm::Value* leftNum = builder->CreateCall(valueToNumber, {left});
-            llvm::Value* rightNum = builder->CreateCall(valueToNumber, {right});
-            llvm::Value* leftBool = builder->CreateFCmpONE(leftNum,
-                llvm::ConstantFP::get(doubleTy, 0.0));
-            llvm::Value* rightBool = builder->CreateFCmpONE(rightNum,
-                llvm::ConstantFP::get(doubleTy, 0.0));
-            llvm::Value* result = builder->CreateAnd(leftBool, rightBool);
-            llvm::Value* resultNum = builder->CreateUIToFP(result, doubleTy);
-            return builder->CreateCall(valueFromNumber, {resultNum});
-        }
-        case BinaryOp::Or: {
-            llvm::Value* leftNum = builder->CreateCall(valueToNumber, {left});
-            llvm::Value* rightNum = builder->CreateCall(valueToNumber, {right});
-            llvm::Value* leftBool = builder->CreateFCmpONE(leftNum,
-                llvm::ConstantFP::get(doubleTy, 0.0));
-            llvm::Value* rightBool = builder->CreateFCmpONE(rightNum,
-                llvm::ConstantFP::get(doubleTy, 0.0));
-            llvm::Value* result = builder->CreateOr(leftBool, rightBool);
-            llvm::Value* resultNum = builder->CreateUIToFP(result, doubleTy);
-            return builder->CreateCall(valueFromNumber, {resultNum});
-        }
+        case BinaryOp::And:
+        case BinaryOp::Or:
+            break; // short-circuited above
     }
 
     return builder->CreateCall(valueFromNumber,
@@ -633,18 +799,11 @@ llvm::Value* CodeGenerator::generateUnaryExpr(UnaryExpression& expr) {
     return builder->CreateCall(valueFromNumber, {neg});
 }
 
-llvm::Function* CodeGenerator::getOrDeclareStdFunction(const std::string& object,
-                                            const std::string& method,
-                                            const FunctionInfo& info) {
-    const std::string key = object + "." + method;
-    if (stdFunctions.contains(key)) return stdFunctions[key];
-
-    std::string objLower = object;
-    std::string methodLower = method;
-    std::ranges::transform(objLower, objLower.begin(), ::tolower);
-    std::ranges::transform(methodLower, methodLower.begin(), ::tolower);
-    const std::string symbol = objLower + "_" + methodLower;
+llvm::Function* CodeGenerator::getOrDeclareStdFunction(const Registry::FunctionEntry& entry) {
+    llvm::Function*& cached = stdFunctions[Registry::functions.indexOf(entry)];
+    if (cached) return cached;
 
+    const FunctionInfo& info = entry.info;
     std::vector<llvm::Type*> paramTypes;
     paramTypes.reserve(info.params.size());
     for (const auto p : info.params) {
@@ -658,29 +817,29 @@ llvm::Function* CodeGenerator::getOrDeclareStdFunction(const std::string& object
     auto* fn = llvm::Function::Create(
         llvm::FunctionType::get(retTy, paramTypes, false),
         llvm::Function::ExternalLinkage,
-        symbol,
+        entry.symbol.view(),
         module.get()
     );
 
-    stdFunctions[key] = fn;
+    cached = fn;
     return fn;
 }
 
 llvm::Value* CodeGenerator::generateCallExpr(const CallExpression& expr) {
-    if (CAST(PropertyAccess, propAccess, expr.callee.get())) {
-        if (CAST(Identifier, objIdent, propAccess->object.get())) {
-            const std::string& objName = objIdent->name;
-            const std::string& methodName = propAccess->property;
+    if (CAST(PropertyAccess, propAccess, expr.callee)) {
+        if (CAST(Identifier, objIdent, propAccess->object)) {
+            const std::string_view objName = program->symbols.name(objIdent->name);
+            const std::string_view methodName = program->symbols.name(propAccess->property);
 
-            if (const auto infoOpt = registry.getFunction(objName, methodName)) {
-                const FunctionInfo& info = *infoOpt;
+            if (const auto* entry = registry.findFunction(objName, methodName)) {
+                const FunctionInfo& info = entry->info;
                 std::vector<llvm::Value*> args;
                 args.reserve(expr.arguments.size());
 
                 for (const auto& a : expr.arguments) {
                     args.push_back(generateExpression(*a));
                 }
-                llvm::Function* fn = getOrDeclareStdFunction(objName, methodName, info);
+                llvm::Function* fn = getOrDeclareStdFunction(*entry);
                 if (info.returnType == ReturnType::Void) {
                     builder->CreateCall(fn, args);
                     return builder->CreateCall(valueFromString, {createStringConstant("")});
@@ -688,12 +847,9 @@ llvm::Value* CodeGenerator::generateCallExpr(const CallExpression& expr) {
                 return builder->CreateCall(fn, args);
             }
         }
-    } else if (CAST(Identifier, ident, expr.callee.get())) {
-        std::string identNameLower = ident->name;
-        std::ranges::transform(identNameLower, identNameLower.begin(), ::tolower);
-        
-        if (subroutines.contains(identNameLower)) {
-            builder->CreateCall(subroutines[identNameLower]);
+    } else if (CAST(Identifier, ident, expr.callee)) {
+        if (llvm::Function* sub = subroutines[program->symbols.folded(ident->name)]) {
+            builder->CreateCall(sub);
             return builder->CreateCall(valueFromString,
                 {createStringConstant("")});
         }
@@ -710,15 +866,11 @@ llvm::Value* CodeGenerator::generateArrayAccess(const ArrayAccess& expr) {
 }
 
 llvm::Value* CodeGenerator::generatePropertyAccess(const PropertyAccess& expr) const {
-    if (CAST(Identifier, objIdent, expr.object.get())) {
-        const std::string& objName = objIdent->name;
-        const std::string& propName = expr.property;
-        if (registry.hasProperty(objName, propName)) {
-            std::string objLower = objName;
-            std::string propLower = propName;
-            std::ranges::transform(objLower, objLower.begin(), ::tolower);
-            std::ranges::transform(propLower, propLower.begin(), ::tolower);
-            const std::string symbol = objLower + "_" + propLower + "_get";
+    if (CAST(Identifier, objIdent, expr.object)) {
+        const std::string_view objName = program->symbols.name(objIdent->name);
+        const std::string_view propName = program->symbols.name(expr.property);
+        if (const auto* entry = registry.findProperty(objName, propName)) {
+            const llvm::StringRef symbol = entry->getter.view();
             llvm::Function* fn = module->getFunction(symbol);
             if (!fn) {
                 auto* fty = llvm::FunctionType::get(valuePtrTy, {}, false);
@@ -732,7 +884,92 @@ llvm::Value* CodeGenerator::generatePropertyAccess(const PropertyAccess& expr) c
         {llvm::ConstantFP::get(doubleTy, 0.0)});
 }
 
-llvm::GlobalVariable* CodeGenerator::createVariable(const std::string& name) const {
+// Marks the variables a subroutine body touches. Subroutines can run from anywhere in Main,
+// including as event handlers, so these must stay globals; every other variable is local to
+// main and is emitted as an alloca that mem2reg can promote to SSA values.
+void CodeGenerator::findSharedVariables(const Statement& stmt) {
+    const auto block = [&](const StatementList& statements) {
+        for (const auto& s : statements) {
+            findSharedVariables(*s);
+        }
+    };
+
+    visit(stmt, Overloaded{
+        [&](const AssignmentStatement& assignStmt) {
+            findSharedVariables(*assignStmt.target);
+            findSharedVariables(*assignStmt.value);
+        },
+        [&](const ExpressionStatement& exprStmt) {
+            findSharedVariables(*exprStmt.expression);
+        },
+        [&](const IfStatement& ifStmt) {
+            findSharedVariables(*ifStmt.condition);
+            block(ifStmt.thenBlock);
+            for (const auto& [cond, statements] : ifStmt.elseIfBlocks) {
+                findSharedVariables(*cond);
+                block(statements);
+            }
+            block(ifStmt.elseBlock);
+        },
+        [&](const WhileStatement& whileStmt) {
+            findSharedVariables(*whileStmt.condition);
+            block(whileStmt.body);
+        },
+        [&](const ForStatement& forStmt) {
+            sharedVariables[program->symbols.folded(forStmt.variable)] = true;
+            findSharedVariables(*forStmt.start);
+            findSharedVariables(*forStmt.end);
+            if (forStmt.step) {
+                findSharedVariables(*forStmt.step);
+            }
+            block(forStmt.body);
+        },
+        [](const auto&) {},
+    });
+}
+
+void CodeGenerator::findSharedVariables(const Expression& expr) {
+    visit(expr, Overloaded{
+        [&](const Identifier& ident) {
+            sharedVariables[program->symbols.folded(ident.name)] = true;
+        },
+        [&](const ArrayAccess& arrAccess) {
+            findSharedVariables(*arrAccess.array);
+            findSharedVariables(*arrAccess.index);
+        },
+        [&](const PropertyAccess& propAccess) {
+            findSharedVariables(*propAccess.object);
+        },
+        [&](const BinaryExpression& binExpr) {
+            findSharedVariables(*binExpr.left);
+            findSharedVariables(*binExpr.right);
+        },
+        [&](const UnaryExpression& unExpr) {
+            findSharedVariables(*unExpr.operand);
+        },
+        [&](const CallExpression& callExpr) {
+            if (callExpr.callee->kind != NodeKind::Identifier) { // a bare name is a subroutine call
+                findSharedVariables(*callExpr.callee);
+            }
+            for (const auto& arg : callExpr.arguments) {
+                findSharedVariables(*arg);
+            }
+        },
+        [](const auto&) {},
+    });
+}
+
+llvm::Value* CodeGenerator::createVariable(const FoldedId key) const {
+    const std::string_view name = program->symbols.foldedName(key);
+
+    if (!sharedVariables[key]) {
+        // allocas go at the top of main's entry block, ahead of runtime_init, so mem2reg sees them
+        llvm::IRBuilder<> entry(runtimeInitCall);
+        llvm::AllocaInst* slot = entry.CreateAlloca(valuePtrTy, nullptr, name);
+        entry.CreateStore(llvm::ConstantPointerNull::get(valuePtrTy), slot);
+        return slot;
+    }
+
     auto* gv = new llvm::GlobalVariable(
         *module,
         valuePtrTy,
@@ -744,18 +981,18 @@ llvm::GlobalVariable* CodeGenerator::createVariable(const std::string& name) con
     return gv;
 }
 
-llvm::GlobalVariable* CodeGenerator::getOrCreateVariable(const std::string& name) {
-    std::string nameLower = name;
-    std::ranges::transform(nameLower, nameLower.begin(), ::tolower);
-    
-    if (!variables.contains(nameLower)) {
-        variables[nameLower] = createVariable(nameLower);
+llvm::Value* CodeGenerator::getOrCreateVariable(const SymbolId name) {
+    const FoldedId key = program->symbols.folded(name);
+    if (!variables[key]) {
+        variables[key] = createVariable(key);
     }
-    return variables[nameLower];
+    return variables[key];
 }
 
 llvm::BasicBlock* CodeGenerator::createBlock(const std::string& name) const {
-    return llvm::BasicBlock::Create(*context, name, mainFunction);
+    // blocks belong to the function being generated, which is a subroutine's while inside one
+    llvm::BasicBlock* insertBlock = builder->GetInsertBlock();
+    return llvm::BasicBlock::Create(*context, name, insertBlock ? insertBlock->getParent() : mainFunction);
 }
 
 llvm::Value* CodeGenerator::createStringConstant(const std::string& str) const {
@@ -777,12 +1014,19 @@ void CodeGenerator::emitIR(const std::string& filename) const {
     module->print(out, nullptr);
 }
 
-void CodeGenerator::emitObjectFile(const std::string& filename) const {
-    llvm::InitializeAllTargetInfos();
-    llvm::InitializeAllTargets();
-    llvm::InitializeAllTargetMCs();
-    llvm::InitializeAllAsmParsers();
-    llvm::InitializeAllAsmPrinters();
+void CodeGenerator::initializeTargets() {
+    static std::once_flag initialized;
+    std::call_once(initialized, [] {
+        llvm::InitializeAllTargetInfos();
+        llvm::InitializeAllTargets();
+        llvm::InitializeAllTargetMCs();
+        llvm::InitializeAllAsmParsers();
+        llvm::InitializeAllAsmPrinters();
+    });
+}
+
+std::unique_ptr<llvm::TargetMachine> CodeGenerator::createTargetMachine() const {
+    initializeTargets();
 
 #if LLVM_VERSION_MAJOR >= 21
     const llvm::Triple targetTriple(llvm::sys::getDefaultTargetTriple());
@@ -797,45 +1041,89 @@ void CodeGenerator::emitObjectFile(const std::string& filename) const {
     const llvm::Target* target = llvm::TargetRegistry::lookupTarget(targetTriple, error);
 
     if (!target) {
-        spdlog::error("Failed to lookup target: {}", error);
-        exit(1);
+        reporter.addError("Failed to lookup target", SourceLocation(1, 1, 0), error);
+        return nullptr;
     }
 
-    const auto cpu = "generic";
-    const char* features = "";
-
     const llvm::TargetOptions opt;
-    llvm::TargetMachine* targetMachine = target->createTargetMachine(
-        targetTriple, cpu, features, opt, llvm::Reloc::PIC_);
+    std::unique_ptr<llvm::TargetMachine> targetMachine(target->createTargetMachine(
+        targetTriple, targetCPU, targetFeatures, opt, llvm::Reloc::PIC_));
 
     if (!targetMachine) {
-        spdlog::error("Failed to create target machine");
-        exit(1);
+        reporter.addError("Failed to create target machine", SourceLocation(1, 1, 0));
+        return nullptr;
     }
 
     module->setDataLayout(targetMachine->createDataLayout());
+    return targetMachine;
+}
 
-    std::error_code ec;
-    llvm::raw_fd_ostream dest(filename, ec, llvm::sys::fs::OF_None);
+// Runs the default O2 pipeline. Generate inserts IR instrumentation that writes .profraw files at
+// exit; Use reads an indexed profile merged by llvm-profdata for branch weights, inlining and layout.
+bool CodeGenerator::optimize(const PGOMode mode, const std::string& profileFile) const {
+    const std::unique_ptr<llvm::TargetMachine> targetMachine = createTargetMachine();
+    if (!targetMachine) return false;
 
-    if (ec) {
-        spdlog::error("Could not open file for writing: {}", ec.message());
-        delete targetMachine;
-        exit(1);
+    std::optional<llvm::PGOOptions> pgo;
+    if (mode != PGOMode::None) {
+        pgo.emplace(profileFile, "", "", "", llvm::vfs::getRealFileSystem(),
+                    mode == PGOMode::Generate ? llvm::PGOOptions::IRInstr : llvm::PGOOptions::IRUse);
     }
 
+    llvm::LoopAnalysisManager lam;
+    llvm::FunctionAnalysisManager fam;
+    llvm::CGSCCAnalysisManager cgam;
+    llvm::ModuleAnalysisManager mam;
+
+    llvm::PassBuilder passBuilder(targetMachine.get(), llvm::PipelineTuningOptions(), pgo);
+    passBuilder.registerModuleAnalyses(mam);
+    passBuilder.registerCGSCCAnalyses(cgam);
+    passBuilder.registerFunctionAnalyses(fam);
+    passBuilder.registerLoopAnalyses(lam);
+    passBuilder.crossRegisterProxies(lam, fam, cgam, mam);
+
+    llvm::ModulePassManager pipeline = passBuilder.buildPerModuleDefaultPipeline(llvm::OptimizationLevel::O2);
+    pipeline.run(*module, mam);
+
+    spdlog::debug("Optimized module");
+    return true;
+}
+
+bool CodeGenerator::emitObject(llvm::SmallVectorImpl<char>& buffer) const {
+    const std::unique_ptr<llvm::TargetMachine> targetMachine = createTargetMachine();
+    if (!targetMachine) return false;
+
+    llvm::raw_svector_ostream dest(buffer);
+
     llvm::legacy::PassManager pass;
     constexpr auto fileType = llvm::CodeGenFileType::ObjectFile;
 
     if (targetMachine->addPassesToEmitFile(pass, dest, nullptr, fileType)) {
-        spdlog::error("TargetMachine can't emit a file of this type");
-        delete targetMachine;
-        exit(1);
+        reporter.addError("TargetMachine can't emit a file of this type", SourceLocation(1, 1, 0));
+        return false;
     }
 
     pass.run(*module);
+
+    spdlog::debug("Successfully generated object ({} bytes)", buffer.size());
+    return true;
+}
+
+bool CodeGenerator::emitObjectFile(const std::string& filename) const {
+    llvm::SmallVector<char, 0> buffer;
+    if (!emitObject(buffer)) return false;
+
+    std::error_code ec;
+    llvm::raw_fd_ostream dest(filename, ec, llvm::sys::fs::OF_None);
+
+    if (ec) {
+        reporter.addError("Could not open file for writing: " + filename, SourceLocation(1, 1, 0), ec.message());
+        return false;
+    }
+
+    dest.write(buffer.data(), buffer.size());
     dest.flush();
 
-    delete targetMachine;
     spdlog::debug("Successfully generated object file: {}", filename);
-}
\ No newline at end of file
+    return true;
+}
@@ -1,27 +1,49 @@
 #pragma once
+#include <array>
 #include <memory>
 #include <string>
 #include <unordered_map>
+#include <vector>
 #include <llvm/IR/IRBuilder.h>
 #include <llvm/IR/LLVMContext.h>
 #include <llvm/IR/Module.h>
 #include <llvm/IR/Value.h>
 #include <llvm/IR/Function.h>
 #include <llvm/IR/BasicBlock.h>
+#include <llvm/Target/TargetMachine.h>
 #include "../parser/ast.hpp"
 #include "../diagnostic.hpp"
 #include "../registry/registry.hpp"
 
+enum class PGOMode {
+    None,
+    Generate,
+    Use
+};
+
 class CodeGenerator {
 public:
+    static constexpr auto targetCPU = "generic";
+    static constexpr auto targetFeatures = "";
+
     explicit CodeGenerator(DiagnosticReporter& diag);
+
+    static void initializeTargets();
     
     bool generate(const Program& program, const std::string& moduleName);
+    void enableProfileCounts(const std::string& sourcePath);
+    void enableProfileSampling(const std::string& sourcePath);
+    bool optimize(PGOMode mode = PGOMode::None, const std::string& profileFile = "") const;
     void emitIR(const std::string& filename) const;
-    void emitObjectFile(const std::string& filename) const;
+    bool emitObject(llvm::SmallVectorImpl<char>& buffer) const;
+    bool emitObjectFile(const std::string& filename) const;
+
+    std::unique_ptr<llvm::LLVMContext> takeContext() { return std::move(context); }
+    std::unique_ptr<llvm::Module> takeModule() { return std::move(module); }
 
 private:
     DiagnosticReporter& reporter;
+    const Program* program;
     std::unique_ptr<llvm::LLVMContext> context;
     std::unique_ptr<llvm::Module> module;
     std::unique_ptr<llvm::IRBuilder<>> builder;
@@ -55,15 +77,36 @@ private:
     llvm::Function* valueLte;
     llvm::Function* valueGte;
 
-    std::unordered_map<std::string, llvm::Function*> stdFunctions;
-    Registry registry;
+    std::array<llvm::Function*, Registry::functions.entries.size()> stdFunctions{}; // by registry entry
 
-    std::unordered_map<std::string, llvm::GlobalVariable*> variables;
-    std::unordered_map<std::string, llvm::BasicBlock*> labels;
-    std::unordered_map<std::string, llvm::Function*> subroutines;
+    // variables and subroutines are case-insensitive and indexed by FoldedId, labels by SymbolId
+    std::vector<llvm::Value*> variables; // a global or, for variables only Main uses, an alloca in main
+    std::vector<bool> sharedVariables;
+    std::vector<llvm::BasicBlock*> labels;
+    std::vector<llvm::Function*> subroutines;
     
     llvm::Function* mainFunction;
     llvm::BasicBlock* currentBlock;
+    llvm::CallInst* runtimeInitCall = nullptr;
+
+    std::unique_ptr<llvm::TargetMachine> createTargetMachine() const;
+
+    struct ProfileSite {
+        size_t line;
+        size_t column;
+        uint32_t function;
+    };
+
+    bool profileCounts = false;
+    bool profileSampling = false;
+    std::string profileSource;
+    std::vector<ProfileSite> profileSites;
+    std::vector<std::string> profileFunctions = {"Main"};
+    uint32_t profileFunction = 0;
+    llvm::GlobalVariable* profileCounters = nullptr;
+    llvm::GlobalVariable* profileCurrentSite = nullptr;
+    llvm::Function* profileEnter = nullptr;
+    llvm::Function* profileLeave = nullptr;
 
     void generateStatement(Statement& stmt);
     llvm::Value* generateExpression(Expression& expr);
@@ -77,6 +120,7 @@ private:
     void generateLabel(LabelStatement& stmt);
     void generateSubroutine(SubroutineStatement& stmt);
 
+    void generateBranch(Expression& cond, llvm::BasicBlock* ifTrue, llvm::BasicBlock* ifFalse);
     llvm::Value* generateBinaryExpr(BinaryExpression& expr);
     llvm::Value* generateUnaryExpr(UnaryExpression& expr);
     llvm::Value* generateCallExpr(const CallExpression& expr);
@@ -86,18 +130,21 @@ private:
     llvm::Value* generateNumberLiteral(NumberLiteral& expr);
     llvm::Value* generateStringLiteral(StringLiteral& expr);
 
+    void emitProfileSite(const ASTNode& node);
+    void finalizeProfile();
+
     void declareRuntimeFunctions();
     void createMainFunction();
-    llvm::GlobalVariable* createVariable(const std::string& name) const;
-    llvm::GlobalVariable* getOrCreateVariable(const std::string& name);
+    void findSharedVariables(const Statement& stmt);
+    void findSharedVariables(const Expression& expr);
+    llvm::Value* createVariable(FoldedId key) const;
+    llvm::Value* getOrCreateVariable(SymbolId name);
     llvm::BasicBlock* createBlock(const std::string& name) const;
     llvm::Value* createStringConstant(const std::string& str) const;
-    llvm::Function* getOrDeclareStdFunction(const std::string& object,
-                                            const std::string& method,
-                                            const FunctionInfo& info);
+    llvm::Function* getOrDeclareStdFunction(const Registry::FunctionEntry& entry);
 
     void generateAssignmentTarget(Expression& target, llvm::Value* value);
-    void assignToVariable(const std::string& name, llvm::Value* value);
+    void assignToVariable(SymbolId name, llvm::Value* value);
     void assignToArray(const ArrayAccess& access, llvm::Value* value);
     void assignToProperty(const PropertyAccess& access, llvm::Value* value);
     void assignToNestedArray(const ArrayAccess& access, llvm::Value* value);
@@ -1,5 +1,7 @@
 #pragma once
+#include <sstream>
 #include <string>
+#include <string_view>
 #include <utility>
 #include <vector>
 #include <iostream>
@@ -47,13 +49,15 @@ struct Diagnostic {
 class DiagnosticReporter {
 private:
     std::vector<Diagnostic> diagnostics;
-    std::string source;
+    std::string_view source; // owned by the caller, e.g. a SourceFile
     std::string filename;
+    std::ostream& out;
     bool hasErrors = false;
+    mutable std::vector<size_t> lineStarts; // offset of each line, built on first use
 
 public:
-    DiagnosticReporter(std::string  src, std::string  fname)
-        : source(std::move(src)), filename(std::move(fname)) {}
+    DiagnosticReporter(const std::string_view src, std::string  fname, std::ostream& output = std::cerr)
+        : source(src), filename(std::move(fname)), out(output) {}
 
     void addError(const std::string& message, SourceLocation location, const std::string& hint = "") {
         diagnostics.emplace_back(DiagnosticLevel::Error, message, location, hint);
@@ -68,33 +72,32 @@ public:
         diagnostics.emplace_back(DiagnosticLevel::Note, message, location, hint);
     }
 
+    // Takes over the diagnostics another reporter collected over the same source, in order.
+    void append(const DiagnosticReporter& other) {
+        diagnostics.insert(diagnostics.end(), other.diagnostics.begin(), other.diagnostics.end());
+        hasErrors = hasErrors || other.hasErrors;
+    }
+
     [[nodiscard]] bool hasErrorsOccurred() const {
         return hasErrors;
     }
 
     [[nodiscard]] std::string getLine(const size_t lineNum) const {
-        size_t currentLine = 1;
-        size_t start = 0;
-
-        for (size_t i = 0; i < source.length(); i++) {
-            if (currentLine == lineNum) {
-                size_t end = i;
-                while (end < source.length() && source[end] != '\n') {
-                    end++;
-                }
-                return source.substr(start, end - start);
-            }
-            if (source[i] == '\n') {
-                currentLine++;
-                start = i + 1;
-            }
+        const auto& starts = lineStartOffsets();
+        if (lineNum == 0 || lineNum > starts.size() || starts[lineNum - 1] >= source.length()) {
+            return "";
         }
-        return "";
+
+        const size_t start = starts[lineNum - 1];
+        const size_t end = lineNum < starts.size() ? starts[lineNum] - 1 : source.length();
+        return std::string(source.substr(start, end - start));
     }
 
     void printDiagnostics() const {
+        // formatted into one buffer and written at once, rather than flushing line by line
+        std::ostringstream buffer;
         for (const auto& diag : diagnostics) {
-            printDiagnostic(diag);
+            printDiagnostic(buffer, diag);
         }
 
         if (hasErrors) {
@@ -105,18 +108,30 @@ public:
                 }
             }
 
-            std::cerr << "\033[1;31merror\033[0m: could not compile `" << filename << "` due to ";
+            buffer << "\033[1;31merror\033[0m: could not compile `" << filename << "` due to ";
             if (errorCount == 1) {
-                std::cerr << "previous error";
+                buffer << "previous error";
             } else {
-                std::cerr << errorCount << " previous errors";
+                buffer << errorCount << " previous errors";
             }
-            std::cerr << std::endl;
+            buffer << '\n';
         }
+
+        out << buffer.view() << std::flush;
     }
 
 private:
-    void printDiagnostic(const Diagnostic& diag) const {
+    const std::vector<size_t>& lineStartOffsets() const {
+        if (lineStarts.empty()) {
+            lineStarts.push_back(0);
+            for (size_t i = source.find('\n'); i != std::string_view::npos; i = source.find('\n', i + 1)) {
+                lineStarts.push_back(i + 1);
+            }
+        }
+        return lineStarts;
+    }
+
+    void printDiagnostic(std::ostream& buffer, const Diagnostic& diag) const {
         std::string levelStr;
         std::string colorCode;
 
@@ -135,25 +150,25 @@ private:
                 break;
         }
 
-        std::cerr << colorCode << levelStr << "\033[0m: " << diag.message << std::endl;
-        std::cerr << "  \033[1;34m-->\033[0m " << filename << ":"
-                  << diag.location.line << ":" << diag.location.column << std::endl;
+        buffer << colorCode << levelStr << "\033[0m: " << diag.message << '\n';
+        buffer << "  \033[1;34m-->\033[0m " << filename << ":"
+                     << diag.location.line << ":" << diag.location.column << '\n';
 
         std::string line = getLine(diag.location.line);
         size_t lineNumWidth = std::to_string(diag.location.line).length();
 
-        std::cerr << std::string(lineNumWidth + 2, ' ') << "\033[1;34m|\033[0m" << std::endl;
-        std::cerr << " \033[1;34m" << diag.location.line << " |\033[0m " << line << std::endl;
+        buffer << std::string(lineNumWidth + 2, ' ') << "\033[1;34m|\033[0m" << '\n';
+        buffer << " \033[1;34m" << diag.location.line << " |\033[0m " << line << '\n';
 
-        std::cerr << std::string(lineNumWidth + 1, ' ') << " \033[1;34m|\033[0m "
-                  << std::string(diag.location.column, ' ')
-                  << colorCode << std::string(diag.location.length, '^') << "\033[0m";
+        buffer << std::string(lineNumWidth + 1, ' ') << " \033[1;34m|\033[0m "
+                     << std::string(diag.location.column, ' ')
+                     << colorCode << std::string(diag.location.length, '^') << "\033[0m";
 
         if (!diag.hint.empty()) {
-            std::cerr << " " << diag.hint;
+            buffer << " " << diag.hint;
         }
 
-        std::cerr << std::endl;
-        std::cerr << std::string(lineNumWidth + 2, ' ') << "\033[1;34m|\033[0m" << std::endl;
+        buffer << '\n';
+        buffer << std::string(lineNumWidth + 2, ' ') << "\033[1;34m|\033[0m" << '\n';
     }
 };
@@ -0,0 +1,330 @@
+#include "folding.hpp"
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+
+#define CAST(Type, var, expr) auto var = nodeCast<Type>(expr)
+
+// The conversions below mirror value_to_number, value_to_string and compare_values in
+// src/std/value.cpp, so a folded expression yields exactly what the program would compute.
+
+static double toNumber(const Constant& value) {
+    if (value.type == Constant::Type::Number) {
+        return value.number;
+    }
+
+    std::string lower = value.string;
+    std::ranges::transform(lower, lower.begin(), ::tolower);
+    if (lower == "true") {
+        return 1.0;
+    } else if (lower == "false") {
+        return 0.0;
+    }
+
+    try {
+        return std::stod(value.string);
+    } catch (...) {
+        return 0.0;
+    }
+}
+
+static std::string toString(const Constant& value) {
+    if (value.type == Constant::Type::String) {
+        return value.string;
+    }
+
+    std::ostringstream oss;
+    oss << std::fixed << std::setprecision(10) << value.number;
+    std::string str = oss.str();
+
+    if (str.find('.') != std::string::npos) {
+        str.erase(str.find_last_not_of('0') + 1, std::string::npos);
+        if (str.back() == '.') {
+            str.pop_back();
+        }
+    }
+    return str;
+}
+
+static int compare(const Constant& left, const Constant& right) {
+    if (left.type == Constant::Type::Number && right.type == Constant::Type::Number) {
+        const double diff = left.number - right.number;
+        if (diff < 0) return -1;
+        if (diff > 0) return 1;
+        return 0;
+    }
+
+    const std::string leftStr = toString(left);
+    const std::string rightStr = toString(right);
+
+    std::string leftLower = leftStr;
+    std::string rightLower = rightStr;
+    std::ranges::transform(leftLower, leftLower.begin(), ::tolower);
+    std::ranges::transform(rightLower, rightLower.begin(), ::tolower);
+
+    if (leftLower == "true" && rightLower == "true") {
+        return 0;
+    }
+
+    return leftStr.compare(rightStr);
+}
+
+// And/Or test their operands with an ordered compare against zero, so NaN counts as false
+static bool isTrue(const Constant& value) {
+    const double number = toNumber(value);
+    return number < 0.0 || number > 0.0;
+}
+
+void ConstantFolder::fold(Program& program) {
+    this->program = &program;
+    assignments.assign(program.symbols.foldedSize(), 0);
+    known.assign(program.symbols.foldedSize(), std::nullopt);
+
+    for (const auto& stmt : program.statements) {
+        countAssignments(*stmt);
+    }
+
+    // subroutines may run before any of Main's assignments, so they only fold literals
+    propagate = false;
+    for (const auto& stmt : program.statements) {
+        if (CAST(SubroutineStatement, subStmt, stmt)) {
+            foldBlock(subStmt->body);
+        }
+    }
+
+    // Main's top-level statements run in order up to the first goto or label, so a constant one
+    // of them assigns is known in every statement after it
+    propagate = true;
+    bool straightLine = true;
+    for (const auto& stmt : program.statements) {
+        if (stmt->kind == NodeKind::SubroutineStatement) continue;
+
+        straightLine = straightLine && !containsJump(*stmt);
+
+        CAST(AssignmentStatement, assignStmt, stmt);
+        CAST(Identifier, ident, assignStmt ? assignStmt->target : nullptr);
+        if (!ident) {
+            foldStatement(*stmt);
+            continue;
+        }
+
+        const std::optional<Constant> value = evaluate(assignStmt->value);
+        const FoldedId key = program.symbols.folded(ident->name);
+        if (straightLine && assignments[key] == 1) {
+            known[key] = value;
+        }
+    }
+}
+
+void ConstantFolder::countAssignments(const Statement& stmt) {
+    visit(stmt, Overloaded{
+        [&](const AssignmentStatement& assignStmt) {
+            countAssignmentTarget(*assignStmt.target);
+        },
+        [&](const IfStatement& ifStmt) {
+            for (const auto& s : ifStmt.thenBlock) countAssignments(*s);
+            for (const auto& [cond, block] : ifStmt.elseIfBlocks) {
+                for (const auto& s : block) countAssignments(*s);
+            }
+            for (const auto& s : ifStmt.elseBlock) countAssignments(*s);
+        },
+        [&](const WhileStatement& whileStmt) {
+            for (const auto& s : whileStmt.body) countAssignments(*s);
+        },
+        [&](const ForStatement& forStmt) {
+            assignments[program->symbols.folded(forStmt.variable)] += 2;
+            for (const auto& s : forStmt.body) countAssignments(*s);
+        },
+        [&](const SubroutineStatement& subStmt) {
+            for (const auto& s : subStmt.body) countAssignments(*s);
+        },
+        [](const auto&) {},
+    });
+}
+
+void ConstantFolder::countAssignmentTarget(const Expression& target) {
+    if (CAST(Identifier, ident, &target)) {
+        assignments[program->symbols.folded(ident->name)] += 1;
+    } else if (CAST(ArrayAccess, access, &target)) {
+        // storing an element replaces the whole value, so an array is never a constant
+        const Expression* root = access->array;
+        while (CAST(ArrayAccess, nested, root)) {
+            root = nested->array;
+        }
+        if (CAST(Identifier, rootIdent, root)) {
+            assignments[program->symbols.folded(rootIdent->name)] += 2;
+        }
+    }
+}
+
+bool ConstantFolder::containsJump(const Statement& stmt) {
+    const auto anyJump = [](const StatementList& block) {
+        return std::ranges::any_of(block, [](const Statement* s) { return containsJump(*s); });
+    };
+
+    return visit(stmt, Overloaded{
+        [](const GotoStatement&) { return true; },
+        [](const LabelStatement&) { return true; },
+        [&](const IfStatement& ifStmt) {
+            return anyJump(ifStmt.thenBlock) || anyJump(ifStmt.elseBlock) ||
+                   std::ranges::any_of(ifStmt.elseIfBlocks, [&](const ElseIfBlock& b) { return anyJump(b.block); });
+        },
+        [&](const WhileStatement& whileStmt) { return anyJump(whileStmt.body); },
+        [&](const ForStatement& forStmt) { return anyJump(forStmt.body); },
+        [](const auto&) { return false; },
+    });
+}
+
+void ConstantFolder::foldBlock(const StatementList block) {
+    for (const auto& s : block) {
+        foldStatement(*s);
+    }
+}
+
+void ConstantFolder::foldStatement(Statement& stmt) {
+    visit(stmt, Overloaded{
+        [&](AssignmentStatement& assignStmt) {
+            // the target itself is stored to, only the indices inside it are read
+            for (auto* access = nodeCast<ArrayAccess>(assignStmt.target); access;
+                 access = nodeCast<ArrayAccess>(access->array)) {
+                evaluate(access->index);
+            }
+            evaluate(assignStmt.value);
+        },
+        [&](ExpressionStatement& exprStmt) {
+            evaluate(exprStmt.expression);
+        },
+        [&](IfStatement& ifStmt) {
+            evaluate(ifStmt.condition);
+            foldBlock(ifStmt.thenBlock);
+
+            std::vector<ElseIfBlock> elseIfBlocks(ifStmt.elseIfBlocks.begin(), ifStmt.elseIfBlocks.end());
+            for (auto& [cond, block] : elseIfBlocks) {
+                evaluate(cond);
+                foldBlock(block);
+            }
+            if (!std::ranges::equal(elseIfBlocks, ifStmt.elseIfBlocks, {}, &ElseIfBlock::condition, &ElseIfBlock::condition)) {
+                ifStmt.elseIfBlocks = program->arena.copy(std::span<const ElseIfBlock>(elseIfBlocks));
+            }
+
+            foldBlock(ifStmt.elseBlock);
+        },
+        [&](WhileStatement& whileStmt) {
+            evaluate(whileStmt.condition);
+            foldBlock(whileStmt.body);
+        },
+        [&](ForStatement& forStmt) {
+            evaluate(forStmt.start);
+            evaluate(forStmt.end);
+            if (forStmt.step) {
+                evaluate(forStmt.step);
+            }
+            foldBlock(forStmt.body);
+        },
+        [](auto&) {},
+    });
+}
+
+std::optional<Constant> ConstantFolder::evaluate(Expression*& expr) {
+    return visit(*expr, Overloaded{
+        [&](NumberLiteral& numLit) -> std::optional<Constant> {
+            return Constant::fromNumber(numLit.value);
+        },
+        [&](StringLiteral& strLit) -> std::optional<Constant> {
+            return Constant::fromString(std::string(strLit.value));
+        },
+        [&](Identifier& ident) -> std::optional<Constant> {
+            // left as a load: a literal would allocate a fresh value at every use
+            return propagate ? known[program->symbols.folded(ident.name)] : std::nullopt;
+        },
+        [&](BinaryExpression& binExpr) -> std::optional<Constant> {
+            auto value = evaluateBinary(binExpr);
+            if (value) {
+                expr = makeLiteral(*value, binExpr.offset);
+            }
+            return value;
+        },
+        [&](UnaryExpression& unExpr) -> std::optional<Constant> {
+            const auto operand = evaluate(unExpr.operand);
+            if (!operand) return std::nullopt;
+
+            auto value = Constant::fromNumber(0.0 - toNumber(*operand));
+            expr = makeLiteral(value, unExpr.offset);
+            return value;
+        },
+        [&](CallExpression& callExpr) -> std::optional<Constant> {
+            foldArguments(callExpr.arguments);
+            return std::nullopt;
+        },
+        [&](ArrayAccess& arrAccess) -> std::optional<Constant> {
+            if (arrAccess.array->kind != NodeKind::Identifier) {
+                evaluate(arrAccess.array);
+            }
+            evaluate(arrAccess.index);
+            return std::nullopt;
+        },
+        [&](PropertyAccess& propAccess) -> std::optional<Constant> {
+            if (propAccess.object->kind != NodeKind::Identifier) {
+                evaluate(propAccess.object);
+            }
+            return std::nullopt;
+        },
+    });
+}
+
+std::optional<Constant> ConstantFolder::evaluateBinary(BinaryExpression& expr) {
+    const auto left = evaluate(expr.left);
+    const auto right = evaluate(expr.right);
+    if (!left || !right) return std::nullopt;
+
+    switch (expr.op) {
+        case BinaryOp::Add:
+            if (left->type == Constant::Type::String || right->type == Constant::Type::String) {
+                return Constant::fromString(toString(*left) + toString(*right));
+            }
+            return Constant::fromNumber(toNumber(*left) + toNumber(*right));
+        case BinaryOp::Subtract:
+            return Constant::fromNumber(toNumber(*left) - toNumber(*right));
+        case BinaryOp::Multiply:
+            return Constant::fromNumber(toNumber(*left) * toNumber(*right));
+        case BinaryOp::Divide: {
+            const double divisor = toNumber(*right);
+            if (divisor == 0.0) return Constant::fromNumber(0.0);
+            return Constant::fromNumber(toNumber(*left) / divisor);
+        }
+        case BinaryOp::Equal:
+            return Constant::fromNumber(compare(*left, *right) == 0 ? 1.0 : 0.0);
+        case BinaryOp::NotEqual:
+            return Constant::fromNumber(compare(*left, *right) != 0 ? 1.0 : 0.0);
+        case BinaryOp::LessThan:
+            return Constant::fromNumber(compare(*left, *right) < 0 ? 1.0 : 0.0);
+        case BinaryOp::GreaterThan:
+            return Constant::fromNumber(compare(*left, *right) > 0 ? 1.0 : 0.0);
+        case BinaryOp::LessThanOrEqual:
+            return Constant::fromNumber(compare(*left, *right) <= 0 ? 1.0 : 0.0);
+        case BinaryOp::GreaterThanOrEqual:
+            return Constant::fromNumber(compare(*left, *right) >= 0 ? 1.0 : 0.0);
+        case BinaryOp::And:
+            return Constant::fromNumber(isTrue(*left) && isTrue(*right) ? 1.0 : 0.0);
+        case BinaryOp::Or:
+            return Constant::fromNumber(isTrue(*left) || isTrue(*right) ? 1.0 : 0.0);
+    }
+    return std::nullopt;
+}
+
+void ConstantFolder::foldArguments(ExpressionList& arguments) {
+    std::vector<Expression*> folded(arguments.begin(), arguments.end());
+    for (auto& arg : folded) {
+        evaluate(arg);
+    }
+    if (!std::ranges::equal(folded, arguments)) {
+        arguments = program->arena.copy(std::span<Expression* const>(folded));
+    }
+}
+
+Expression* ConstantFolder::makeLiteral(const Constant& value, const uint32_t offset) {
+    if (value.type == Constant::Type::Number) {
+        return program->arena.make<NumberLiteral>(value.number, offset);
+    }
+    return program->arena.make<StringLiteral>(program->arena.copy(value.string), offset);
+}
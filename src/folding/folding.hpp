@@ -0,0 +1,47 @@
+#pragma once
+#include <optional>
+#include <string>
+#include <vector>
+#include "../parser/ast.hpp"
+
+// A value known at compile time, typed like the runtime's Primitive.
+struct Constant {
+    enum class Type { Number, String };
+
+    Type type;
+    double number = 0.0;
+    std::string string;
+
+    static Constant fromNumber(const double value) { return {Type::Number, value, {}}; }
+    static Constant fromString(std::string value) { return {Type::String, 0.0, std::move(value)}; }
+};
+
+// Runs between semantic analysis and codegen. Replaces every subexpression whose operands are all
+// constant with the literal the runtime would have computed, and treats variables that Main assigns
+// exactly once, with a constant, as that constant wherever the assignment is known to have run.
+class ConstantFolder {
+public:
+    ConstantFolder() : program(nullptr), propagate(false) {}
+
+    void fold(Program& program);
+
+private:
+    Program* program;
+
+    // by FoldedId: how often each variable is assigned (arrays and For loops count as many), and the
+    // value of those assigned once with a constant, from the point that assignment has run
+    std::vector<unsigned> assignments;
+    std::vector<std::optional<Constant>> known;
+    bool propagate;
+
+    void countAssignments(const Statement& stmt);
+    void countAssignmentTarget(const Expression& target);
+    static bool containsJump(const Statement& stmt);
+
+    void foldStatement(Statement& stmt);
+    void foldBlock(StatementList block);
+    std::optional<Constant> evaluate(Expression*& expr);
+    std::optional<Constant> evaluateBinary(BinaryExpression& expr);
+    void foldArguments(ExpressionList& arguments);
+    Expression* makeLiteral(const Constant& value, uint32_t offset);
+};
@@ -0,0 +1,45 @@
+#include "jit.hpp"
+#include <llvm/ExecutionEngine/Orc/LLJIT.h>
+#include <llvm/ExecutionEngine/Orc/ExecutionUtils.h>
+#include <llvm/ExecutionEngine/Orc/TargetProcess/TargetExecutionUtils.h>
+#include <llvm/ExecutionEngine/Orc/ThreadSafeModule.h>
+#include <llvm/Support/Error.h>
+#include <llvm/Support/TargetSelect.h>
+
+JIT::JIT(DiagnosticReporter &diag) : reporter(diag) {}
+
+std::optional<int> JIT::run(std::unique_ptr<llvm::LLVMContext> context, std::unique_ptr<llvm::Module> module,
+             const std::string &programName, const std::vector<std::string> &args) {
+    llvm::InitializeNativeTarget();
+    llvm::InitializeNativeTargetAsmPrinter();
+
+    auto jit = llvm::orc::LLJITBuilder().create();
+    if (!jit) {
+        reporter.addError("Failed to create JIT", SourceLocation(1, 1, 0), llvm::toString(jit.takeError()));
+        return std::nullopt;
+    }
+
+    // runtime symbols are linked into the compiler itself and exported from it
+    auto generator = llvm::orc::DynamicLibrarySearchGenerator::GetForCurrentProcess(
+        (*jit)->getDataLayout().getGlobalPrefix());
+    if (!generator) {
+        reporter.addError("Failed to expose runtime symbols", SourceLocation(1, 1, 0),
+                          llvm::toString(generator.takeError()));
+        return std::nullopt;
+    }
+    (*jit)->getMainJITDylib().addGenerator(std::move(*generator));
+
+    if (auto err = (*jit)->addIRModule(llvm::orc::ThreadSafeModule(std::move(module), std::move(context)))) {
+        reporter.addError("Failed to add module to JIT", SourceLocation(1, 1, 0), llvm::toString(std::move(err)));
+        return std::nullopt;
+    }
+
+    auto mainSymbol = (*jit)->lookup("main");
+    if (!mainSymbol) {
+        reporter.addError("Failed to find main", SourceLocation(1, 1, 0), llvm::toString(mainSymbol.takeError()));
+        return std::nullopt;
+    }
+
+    const auto mainFn = mainSymbol->toPtr<int (*)(int, char**)>();
+    return llvm::orc::runAsMain(mainFn, args, programName);
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/Module.h>
+#include "../diagnostic.hpp"
+
+class JIT {
+public:
+    explicit JIT(DiagnosticReporter &diag);
+
+    // Returns the program's exit code, or nullopt after reporting why it could not be started.
+    std::optional<int> run(std::unique_ptr<llvm::LLVMContext> context, std::unique_ptr<llvm::Module> module,
+            const std::string &programName, const std::vector<std::string> &args);
+
+private:
+    DiagnosticReporter& reporter;
+};
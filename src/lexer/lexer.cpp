@@ -1,21 +1,15 @@
 #include "lexer.hpp"
 
 #include <algorithm>
-#include <iostream>
+#include <atomic>
+#include <functional>
+#include <thread>
 
-char Lexer::eat() {
-    const char c = this->peek();
-    if (c == '\0') return c;
+#include "scan.hpp"
 
-    if (c == '\n') {
-        this->line++;
-        this->col = 0;
-    } else {
-        this->col++;
-    }
-    this->pos++;
-    return c;
-}
+// below this, starting threads costs more than lexing the whole input on one core
+static constexpr size_t parallelThreshold = 4 << 20;
+static constexpr size_t minChunkSize = 1 << 20;
 
 char Lexer::peek(const size_t offset) const {
     if (this->pos + offset >= this->source.length()) return '\0';
@@ -23,151 +17,297 @@ char Lexer::peek(const size_t offset) const {
 }
 
 void Lexer::skipIgnored() {
-    bool skippedSomething;
-    do {
-        skippedSomething = false;
-
-        while (std::isspace(this->peek())) {
-            this->eat();
-            skippedSomething = true;
-        }
+    const char* begin = this->source.data();
+    const char* end = begin + this->source.size();
+    const char* p = begin + this->pos;
+    const char* lineStartPtr = begin + this->lineStart;
+
+    while (true) {
+        p = scan::skipWhitespace(p, end, this->line, lineStartPtr);
+        if (p == end || *p != '\'') break;
+        // the comment's newline is left for the next whitespace skip to count
+        p = scan::findAny(p, end, '\n', '\0', '\n');
+    }
 
-        if (this->peek() == '\'') {
-            while (this->peek() != '\n' && this->peek() != '\0') {
-                this->eat();
-            }
-            skippedSomething = true;
-        }
-    } while (skippedSomething);
+    this->pos = p - begin;
+    this->lineStart = lineStartPtr - begin;
 }
 
 Token Lexer::makeString() {
-    const size_t startColumn = this->col;
+    const size_t startColumn = this->column();
     const size_t startLine = this->line;
-    this->eat();
-
-    std::string value;
-    while (this->peek() != '"' && this->peek() != '\0') {
-        if (this->peek() == '\n') {
-            this->reporter->addError("unterminated string literal",
-                SourceLocation(startLine, startColumn, 1),
-                "strings cannot span multiple lines");
-            break;
-        }
-        value += this->eat();
-    }
+    const size_t startPos = this->pos;
+
+    const char* begin = this->source.data();
+    const char* end = begin + this->source.size();
+    this->pos = scan::findAny(begin + startPos + 1, end, '"', '\n', '\0') - begin;
+
+    const std::string_view value = this->source.substr(startPos + 1, this->pos - startPos - 1);
 
     if (this->peek() == '"') {
-        this->eat(); // skip closing "
-    } else if (this->peek() == '\0') {
+        this->pos++; // skip closing "
+    } else if (this->peek() == '\n') {
+        this->reporter->addError("unterminated string literal",
+            SourceLocation(startLine, startColumn, 1),
+            "strings cannot span multiple lines");
+    } else {
         this->reporter->addError("unterminated string literal",
             SourceLocation(startLine, startColumn, 1),
             "expected closing `\"`");
     }
 
-    return {TokenTyp::StringLiteral, value, startLine, startColumn};
+    return {TokenTyp::StringLiteral, value, startPos, startLine, startColumn};
 }
 
 Token Lexer::makeNumber() {
-    const size_t startColumn = this->col;
-    const size_t startLine = this->line;
-    std::string value;
+    const size_t startPos = this->pos;
 
-    bool seenDot = false;
-    while (std::isdigit(peek()) || (peek() == '.' && !seenDot)) {
-        if (peek() == '.') seenDot = true;
-        value += eat();
+    while (scan::table.is(this->peek(), scan::Digit)) this->pos++;
+    if (this->peek() == '.') {
+        this->pos++;
+        while (scan::table.is(this->peek(), scan::Digit)) this->pos++;
     }
 
-    return {TokenTyp::NumberLiteral, value, startLine, startColumn};
+    return {TokenTyp::NumberLiteral, this->source.substr(startPos, this->pos - startPos),
+            startPos, this->line, startPos - this->lineStart};
 }
 
 Token Lexer::makeIdentifier() {
-    const size_t startColumn = this->col;
-    const size_t startLine = this->line;
-    std::string value;
+    const size_t startPos = this->pos;
 
-    while (std::isalnum(this->peek()) || this->peek() == '_') {
-        value += this->eat();
-    }
+    const char* begin = this->source.data();
+    this->pos = scan::skipIdentifier(begin + startPos, begin + this->source.size()) - begin;
+
+    const std::string_view value = this->source.substr(startPos, this->pos - startPos);
+    return {classifyKeyword(value), value, startPos, this->line, startPos - this->lineStart};
+}
 
-    std::string lowerValue = value;
-    std::ranges::transform(lowerValue, lowerValue.begin(),
-                           [](const unsigned char c) { return std::tolower(c); });
+Token Lexer::makeOperator() {
+    const size_t startPos = this->pos;
 
-    if (this->keywords.contains(lowerValue)) {
-        return {this->keywords[lowerValue], value, startLine, startColumn};
+    TokenTyp type = classifyTwoCharOperator(this->peek(), this->peek(1));
+    if (type != TokenTyp::Unrecognized) {
+        this->pos += 2;
+    } else {
+        type = classifySingleCharOperator(this->peek());
+        this->pos++;
     }
 
-    return {TokenTyp::Identifier, value, startLine, startColumn};
+    return {type, this->source.substr(startPos, this->pos - startPos), startPos, this->line, startPos - this->lineStart};
 }
 
+// keywords are matched case-insensitively; `keyword` is always lower case
+static bool equalsKeyword(const std::string_view word, const std::string_view keyword) {
+    for (size_t i = 0; i < keyword.size(); i++) {
+        if ((word[i] | 0x20) != keyword[i]) return false;
+    }
+    return true;
+}
 
-Token Lexer::makeTwoCharOperator() {
-    const size_t startColumn = this->col;
-    const size_t startLine = this->line;
-    std::string current;
-    current += this->eat();
-    current += this->eat();
+// The length selects a handful of candidates and the first letter at most two,
+// so every identifier costs at most two short comparisons.
+TokenTyp Lexer::classifyKeyword(const std::string_view word) {
+    const char first = static_cast<char>(word[0] | 0x20);
+
+    switch (word.size()) {
+        case 2:
+            if (first == 'i' && equalsKeyword(word, "if")) return TokenTyp::If;
+            if (first == 't' && equalsKeyword(word, "to")) return TokenTyp::To;
+            if (first == 'o' && equalsKeyword(word, "or")) return TokenTyp::Or;
+            break;
+        case 3:
+            if (first == 'f' && equalsKeyword(word, "for")) return TokenTyp::For;
+            if (first == 's' && equalsKeyword(word, "sub")) return TokenTyp::Sub;
+            if (first == 'a' && equalsKeyword(word, "and")) return TokenTyp::And;
+            break;
+        case 4:
+            if (first == 't' && equalsKeyword(word, "then")) return TokenTyp::Then;
+            if (first == 'e' && equalsKeyword(word, "else")) return TokenTyp::Else;
+            if (first == 's' && equalsKeyword(word, "step")) return TokenTyp::Step;
+            if (first == 'g' && equalsKeyword(word, "goto")) return TokenTyp::GoTo;
+            break;
+        case 5:
+            if (first == 'e' && equalsKeyword(word, "endif")) return TokenTyp::EndIf;
+            if (first == 'w' && equalsKeyword(word, "while")) return TokenTyp::While;
+            break;
+        case 6:
+            if (first != 'e') break;
+            if (equalsKeyword(word, "elseif")) return TokenTyp::ElseIf;
+            if (equalsKeyword(word, "endfor")) return TokenTyp::EndFor;
+            if (equalsKeyword(word, "endsub")) return TokenTyp::EndSub;
+            break;
+        case 8:
+            if (first == 'e' && equalsKeyword(word, "endwhile")) return TokenTyp::EndWhile;
+            break;
+        default:
+            break;
+    }
 
-    return {this->twoCharSymbols[current], current, startLine, startColumn};
+    return TokenTyp::Identifier;
 }
 
-Token Lexer::makeSingleCharOperator() {
-    const size_t startColumn = this->col;
-    const size_t startLine = this->line;
-    std::string current(1, this->eat());
+TokenTyp Lexer::classifyTwoCharOperator(const char first, const char second) {
+    if (first == '<' && second == '=') return TokenTyp::LessThanOrEqual;
+    if (first == '>' && second == '=') return TokenTyp::GreaterThanOrEqual;
+    if (first == '<' && second == '>') return TokenTyp::NotEqual;
+    return TokenTyp::Unrecognized;
+}
 
-    return {this->symbols[current], current, startLine, startColumn};
+TokenTyp Lexer::classifySingleCharOperator(const char c) {
+    switch (c) {
+        case '.': return TokenTyp::Dot;
+        case ',': return TokenTyp::Comma;
+        case '(': return TokenTyp::LeftParen;
+        case ')': return TokenTyp::RightParen;
+        case '[': return TokenTyp::LeftBracket;
+        case ']': return TokenTyp::RightBracket;
+        case '=': return TokenTyp::Equal;
+        case '+': return TokenTyp::Plus;
+        case '-': return TokenTyp::Minus;
+        case '*': return TokenTyp::Multiply;
+        case '/': return TokenTyp::Divide;
+        case ':': return TokenTyp::Colon;
+        case '<': return TokenTyp::LessThan;
+        case '>': return TokenTyp::GreaterThan;
+        default: return TokenTyp::Unrecognized;
+    }
 }
 
-std::vector<Token> Lexer::tokenize(const std::string &input, DiagnosticReporter& diag) {
+void Lexer::start(const std::string_view input, DiagnosticReporter& diag) {
     this->source = input;
     this->pos = 0;
     this->line = 1;
-    this->col = 0;
+    this->lineStart = 0;
     this->reporter = &diag;
+}
 
-    std::vector<Token> tokens;
-    while (this->peek() != '\0') {
+Token Lexer::next() {
+    while (true) {
         this->skipIgnored();
 
-        if (this->peek() == '\0') break;
-
-        if (peek() == '"') {
-            tokens.push_back(this->makeString());
-            continue;
+        const char c = this->peek();
+        if (c == '\0') {
+            return {TokenTyp::EndOfFile, std::string_view(), this->pos, this->line, this->column()};
         }
 
-        if (std::isdigit(peek())) {
-            tokens.push_back(this->makeNumber());
-            continue;
+        if (c == '"') {
+            return this->makeString();
         }
 
-        if (std::isalpha(peek()) || peek() == '_') {
-            tokens.push_back(this->makeIdentifier());
-            continue;
+        if (scan::table.is(c, scan::Digit)) {
+            return this->makeNumber();
         }
 
-        std::string twoChar(1, this->peek());
-        twoChar += peek(1);
-
-        if (this->twoCharSymbols.contains(twoChar)) {
-            tokens.push_back(this->makeTwoCharOperator());
-            continue;
+        if (scan::table.is(c, scan::IdentifierChar)) {
+            return this->makeIdentifier();
         }
 
-        std::string singleChar(1, this->peek());
-        if (this->symbols.contains(singleChar)) {
-            tokens.push_back(this->makeSingleCharOperator());
-            continue;
+        if (classifySingleCharOperator(c) != TokenTyp::Unrecognized) {
+            return this->makeOperator();
         }
 
-        reporter->addError("unexpected character: '" + singleChar + "'",
-            SourceLocation(line, col, 1),
+        reporter->addError("unexpected character: '" + std::string(1, c) + "'",
+            SourceLocation(line, column(), 1),
             "this character is not valid in this context");
-        this->eat();
+        this->pos++;
+    }
+}
+
+std::vector<Token> Lexer::tokenize(const std::string_view input, DiagnosticReporter& diag) {
+    if (const unsigned threads = std::thread::hardware_concurrency(); threads > 1 && input.size() >= parallelThreshold) {
+        return tokenizeParallel(input, diag, threads);
+    }
+
+    this->start(input, diag);
+
+    std::vector<Token> tokens;
+    // roughly one token per five characters of typical SmallBasic source
+    tokens.reserve(input.size() / 5);
+
+    while (true) {
+        const Token token = this->next();
+        if (token.type == TokenTyp::EndOfFile) break;
+        tokens.push_back(token);
     }
 
     return tokens;
 }
+
+static void runOnWorkers(const size_t count, const unsigned threads, const std::function<void(size_t)>& task) {
+    std::atomic<size_t> next = 0;
+    const auto worker = [&] {
+        for (size_t i = next++; i < count; i = next++) {
+            task(i);
+        }
+    };
+
+    std::vector<std::jthread> workers;
+    for (unsigned i = 0; i < std::min<size_t>(threads, count); i++) {
+        workers.emplace_back(worker);
+    }
+}
+
+// Strings and comments end at a newline, so a chunk starting right after one lexes exactly as it
+// would in a single pass, given the line it starts on. Chunks share the input, keeping offsets and
+// columns absolute.
+std::vector<Token> Lexer::tokenizeParallel(const std::string_view input, DiagnosticReporter& diag, const unsigned threads) {
+    const size_t chunkCount = std::min<size_t>(input.size() / minChunkSize, threads * 4);
+
+    std::vector<size_t> bounds{0};
+    for (size_t i = 1; i < chunkCount; i++) {
+        const size_t newline = input.find('\n', std::max(bounds.back(), input.size() * i / chunkCount));
+        if (newline == std::string_view::npos) break;
+        bounds.push_back(newline + 1);
+    }
+    if (bounds.back() != input.size()) bounds.push_back(input.size());
+    const size_t chunks = bounds.size() - 1;
+
+    std::vector<size_t> firstLines(chunks + 1, 1);
+    runOnWorkers(chunks, threads, [&](const size_t i) {
+        firstLines[i + 1] = std::count(input.begin() + bounds[i], input.begin() + bounds[i + 1], '\n');
+    });
+    for (size_t i = 1; i <= chunks; i++) {
+        firstLines[i] += firstLines[i - 1];
+    }
+
+    std::vector<std::vector<Token>> tokens(chunks);
+    std::vector<DiagnosticReporter> reporters;
+    reporters.reserve(chunks);
+    for (size_t i = 0; i < chunks; i++) {
+        reporters.emplace_back(input, "");
+    }
+    // a NUL ends the input early, see next(); chunks after the one containing it are discarded
+    std::vector<char> endsEarly(chunks, false);
+
+    runOnWorkers(chunks, threads, [&](const size_t i) {
+        Lexer lexer;
+        lexer.start(input.substr(0, bounds[i + 1]), reporters[i]);
+        lexer.pos = bounds[i];
+        lexer.line = firstLines[i];
+        lexer.lineStart = bounds[i];
+
+        tokens[i].reserve((bounds[i + 1] - bounds[i]) / 5);
+        while (true) {
+            const Token token = lexer.next();
+            if (token.type == TokenTyp::EndOfFile) {
+                endsEarly[i] = token.offset < bounds[i + 1];
+                break;
+            }
+            tokens[i].push_back(token);
+        }
+    });
+
+    size_t total = 0;
+    for (const auto& chunk : tokens) total += chunk.size();
+
+    std::vector<Token> result;
+    result.reserve(total);
+    for (size_t i = 0; i < chunks; i++) {
+        for (const Token& token : tokens[i]) {
+            result.push_back(token);
+        }
+        diag.append(reporters[i]);
+        if (endsEarly[i]) break;
+    }
+    return result;
+}
@@ -1,6 +1,6 @@
 #pragma once
-#include <map>
 #include <string>
+#include <string_view>
 #include <vector>
 
 #include "token.hpp"
@@ -8,65 +8,35 @@
 
 class Lexer {
 public:
-    Lexer(): reporter(nullptr), pos(0), line(1), col(0) {}
-    std::vector<Token> tokenize(const std::string& input, DiagnosticReporter& diag);
+    Lexer(): reporter(nullptr), pos(0), line(1), lineStart(0) {}
+    // Tokens point into input, so it has to stay alive as long as they do.
+    void start(std::string_view input, DiagnosticReporter& diag);
+    // Produces tokens on demand; returns EndOfFile once the input is exhausted.
+    Token next();
+    // Inputs of several megabytes are split at newlines and lexed on all cores.
+    std::vector<Token> tokenize(std::string_view input, DiagnosticReporter& diag);
 private:
+    static std::vector<Token> tokenizeParallel(std::string_view input, DiagnosticReporter& diag, unsigned threads);
+
     void skipIgnored();
 
     Token makeString();
     Token makeNumber();
     Token makeIdentifier();
-    Token makeTwoCharOperator();
-    Token makeSingleCharOperator();
+    Token makeOperator();
+
+    static TokenTyp classifyKeyword(std::string_view word);
+    static TokenTyp classifyTwoCharOperator(char first, char second);
+    static TokenTyp classifySingleCharOperator(char c);
 
     [[nodiscard]] char peek(size_t offset = 0) const;
-    char eat();
+    [[nodiscard]] size_t column() const { return this->pos - this->lineStart; }
 
     DiagnosticReporter* reporter;
-    std::string source;
+    std::string_view source;
     size_t pos;
+    // newlines only occur in skipped whitespace, where they are counted in bulk;
+    // a token's column is its offset from the start of its line
     size_t line;
-    size_t col;
-
-    std::map<std::string, TokenTyp> keywords = {
-        {"if", TokenTyp::If},
-        {"then", TokenTyp::Then},
-        {"else", TokenTyp::Else},
-        {"elseif", TokenTyp::ElseIf},
-        {"endif", TokenTyp::EndIf},
-        {"for", TokenTyp::For},
-        {"to", TokenTyp::To},
-        {"step", TokenTyp::Step},
-        {"endfor", TokenTyp::EndFor},
-        {"while", TokenTyp::While},
-        {"endwhile", TokenTyp::EndWhile},
-        {"sub", TokenTyp::Sub},
-        {"endsub", TokenTyp::EndSub},
-        {"goto", TokenTyp::GoTo},
-        {"or", TokenTyp::Or},
-        {"and", TokenTyp::And}
-    };
-
-    std::map<std::string, TokenTyp> symbols = {
-        {".", TokenTyp::Dot},
-        {",", TokenTyp::Comma},
-        {"(", TokenTyp::LeftParen},
-        {")", TokenTyp::RightParen},
-        {"[", TokenTyp::LeftBracket},
-        {"]", TokenTyp::RightBracket},
-        {"=", TokenTyp::Equal},
-        {"+", TokenTyp::Plus},
-        {"-", TokenTyp::Minus},
-        {"*", TokenTyp::Multiply},
-        {"/", TokenTyp::Divide},
-        {":", TokenTyp::Colon},
-        {"<", TokenTyp::LessThan},
-        {">", TokenTyp::GreaterThan}
-    };
-
-    std::map<std::string, TokenTyp> twoCharSymbols = {
-        {"<=", TokenTyp::LessThanOrEqual},
-        {">=", TokenTyp::GreaterThanOrEqual},
-        {"<>", TokenTyp::NotEqual}
-    };
+    size_t lineStart;
 };
@@ -0,0 +1,146 @@
+#pragma once
+#include <bit>
+#include <cstdint>
+#include <cstddef>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SMALLBASIC_SCAN_SSE2
+#endif
+
+// Bulk character classification for the lexer. Each scanner returns the first byte in [p, end)
+// that ends the run it is looking for, or end. Blocks of 32 (AVX2) or 16 (SSE2) bytes are
+// classified at once; the tail and other targets use a lookup table.
+namespace scan {
+
+enum CharClass : uint8_t {
+    Whitespace = 1,
+    IdentifierChar = 2,
+    Digit = 4,
+};
+
+struct ClassTable {
+    uint8_t classes[256] = {};
+
+    constexpr ClassTable() {
+        // matches std::isspace/std::isalnum in the "C" locale the lexer always assumed
+        for (const char c : {' ', '\t', '\n', '\v', '\f', '\r'}) classes[static_cast<uint8_t>(c)] |= Whitespace;
+        for (int c = 'a'; c <= 'z'; c++) classes[c] |= IdentifierChar;
+        for (int c = 'A'; c <= 'Z'; c++) classes[c] |= IdentifierChar;
+        for (int c = '0'; c <= '9'; c++) classes[c] |= IdentifierChar | Digit;
+        classes[static_cast<uint8_t>('_')] |= IdentifierChar;
+    }
+
+    [[nodiscard]] constexpr bool is(const char c, const CharClass cls) const {
+        return classes[static_cast<uint8_t>(c)] & cls;
+    }
+};
+
+inline constexpr ClassTable table;
+
+#if defined(__AVX2__)
+using Block = __m256i;
+constexpr size_t blockSize = 32;
+
+inline Block load(const char* p) { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)); }
+inline Block splat(const char c) { return _mm256_set1_epi8(c); }
+inline Block eq(const Block a, const Block b) { return _mm256_cmpeq_epi8(a, b); }
+inline Block gt(const Block a, const Block b) { return _mm256_cmpgt_epi8(a, b); }
+inline Block both(const Block a, const Block b) { return _mm256_and_si256(a, b); }
+inline Block either(const Block a, const Block b) { return _mm256_or_si256(a, b); }
+inline uint32_t bits(const Block a) { return static_cast<uint32_t>(_mm256_movemask_epi8(a)); }
+#define SMALLBASIC_SCAN_SIMD
+#elif defined(SMALLBASIC_SCAN_SSE2)
+using Block = __m128i;
+constexpr size_t blockSize = 16;
+
+inline Block load(const char* p) { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)); }
+inline Block splat(const char c) { return _mm_set1_epi8(c); }
+inline Block eq(const Block a, const Block b) { return _mm_cmpeq_epi8(a, b); }
+inline Block gt(const Block a, const Block b) { return _mm_cmpgt_epi8(a, b); }
+inline Block both(const Block a, const Block b) { return _mm_and_si128(a, b); }
+inline Block either(const Block a, const Block b) { return _mm_or_si128(a, b); }
+inline uint32_t bits(const Block a) { return static_cast<uint32_t>(_mm_movemask_epi8(a)); }
+#define SMALLBASIC_SCAN_SIMD
+#endif
+
+#ifdef SMALLBASIC_SCAN_SIMD
+constexpr uint32_t fullMask = blockSize == 32 ? 0xFFFFFFFFu : 0xFFFFu;
+
+// signed byte compares: bytes >= 0x80 are negative and fall outside every ASCII range
+inline Block inRange(const Block v, const char lo, const char hi) {
+    return both(gt(v, splat(static_cast<char>(lo - 1))), gt(splat(static_cast<char>(hi + 1)), v));
+}
+
+inline Block whitespace(const Block v) {
+    return either(eq(v, splat(' ')), inRange(v, '\t', '\r'));
+}
+
+inline Block identifierChars(const Block v) {
+    const Block lower = either(v, splat(0x20));
+    return either(either(inRange(lower, 'a', 'z'), inRange(v, '0', '9')), eq(v, splat('_')));
+}
+#endif
+
+// Skips whitespace, counting the newlines crossed and remembering where the last line starts.
+inline const char* skipWhitespace(const char* p, const char* end, size_t& newlines, const char*& lineStart) {
+#ifdef SMALLBASIC_SCAN_SIMD
+    while (end - p >= static_cast<ptrdiff_t>(blockSize)) {
+        const Block v = load(p);
+        const uint32_t stop = ~bits(whitespace(v)) & fullMask;
+        uint32_t nl = bits(eq(v, splat('\n')));
+        if (stop) {
+            nl &= (1u << std::countr_zero(stop)) - 1;
+        }
+        if (nl) {
+            newlines += std::popcount(nl);
+            lineStart = p + (31 - std::countl_zero(nl)) + 1;
+        }
+        if (stop) {
+            return p + std::countr_zero(stop);
+        }
+        p += blockSize;
+    }
+#endif
+    while (p < end && table.is(*p, Whitespace)) {
+        if (*p == '\n') {
+            newlines++;
+            lineStart = p + 1;
+        }
+        p++;
+    }
+    return p;
+}
+
+inline const char* skipIdentifier(const char* p, const char* end) {
+#ifdef SMALLBASIC_SCAN_SIMD
+    while (end - p >= static_cast<ptrdiff_t>(blockSize)) {
+        if (const uint32_t stop = ~bits(identifierChars(load(p))) & fullMask) {
+            return p + std::countr_zero(stop);
+        }
+        p += blockSize;
+    }
+#endif
+    while (p < end && table.is(*p, IdentifierChar)) p++;
+    return p;
+}
+
+// First occurrence of any of three bytes, e.g. the closing quote, newline or NUL ending a string.
+inline const char* findAny(const char* p, const char* end, const char a, const char b, const char c) {
+#ifdef SMALLBASIC_SCAN_SIMD
+    const Block va = splat(a), vb = splat(b), vc = splat(c);
+    while (end - p >= static_cast<ptrdiff_t>(blockSize)) {
+        const Block v = load(p);
+        if (const uint32_t hit = bits(either(either(eq(v, va), eq(v, vb)), eq(v, vc)))) {
+            return p + std::countr_zero(hit);
+        }
+        p += blockSize;
+    }
+#endif
+    while (p < end && *p != a && *p != b && *p != c) p++;
+    return p;
+}
+
+}
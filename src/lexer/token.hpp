@@ -1,5 +1,6 @@
 #pragma once
 #include <string>
+#include <string_view>
 
 enum class TokenTyp {
     If,
@@ -38,18 +39,21 @@ enum class TokenTyp {
     Identifier,
     NumberLiteral,
     StringLiteral,
+    EndOfFile,
     Unrecognized,
 };
 
+// Tokens view into the source buffer passed to Lexer::tokenize, which must outlive them.
 class Token {
 public:
     const TokenTyp type;
-    const std::string value;
+    const std::string_view value;
+    const size_t offset;
     const size_t line;
     const size_t column;
 
-    Token(TokenTyp t, std::string v, size_t l, size_t c)
-        : type(t), value(std::move(v)), line(l), column(c) {}
+    Token(TokenTyp t, std::string_view v, size_t o, size_t l, size_t c)
+        : type(t), value(v), offset(o), line(l), column(c) {}
 };
 
 inline std::string tokenTypeToString(const TokenTyp tokenType) {
@@ -90,6 +94,7 @@ inline std::string tokenTypeToString(const TokenTyp tokenType) {
         case TokenTyp::Identifier: return "Identifier";
         case TokenTyp::NumberLiteral: return "NumberLiteral";
         case TokenTyp::StringLiteral: return "StringLiteral";
+        case TokenTyp::EndOfFile: return "EndOfFile";
         default: return "Unrecognized";
     }
 }
\ No newline at end of file
@@ -1,6 +1,18 @@
 #include "linker.hpp"
 #include <spdlog/spdlog.h>
-#include <cstdlib>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/Program.h>
+#include <llvm/Support/raw_ostream.h>
+#include <cctype>
+#include <mutex>
+
+#ifdef SMALLBASIC_HAS_LLD
+#include <lld/Common/Driver.h>
+#include <llvm/TargetParser/Host.h>
+#include <llvm/TargetParser/Triple.h>
+
+LLD_HAS_DRIVER(elf)
+#endif
 
 #ifdef _WIN32
     #include <windows.h>
@@ -16,35 +28,191 @@ Linker::Linker(DiagnosticReporter &diag) : reporter(diag) {
 #endif
 }
 
-void Linker::link(const std::string &object, const std::string &output, const std::string &pathStd) {
+// Extra archives linked after the standard library, e.g. the profile runtime for --profile-generate.
+void Linker::add_library(const std::string &path) {
+    libraries.push_back(path);
+}
+
+bool Linker::link(const llvm::SmallVectorImpl<char> &object, const std::string &output, const std::string &pathStd) {
+    const std::optional<std::string> stdPath = find_std(pathStd);
+    if (!stdPath) return false;
+
+    // linkers only read inputs from disk; a unique name keeps concurrent builds apart
+    int fd;
+    llvm::SmallString<128> objectPath;
+    if (const auto ec = llvm::sys::fs::createTemporaryFile("smallbasic", "o", fd, objectPath)) {
+        reporter.addError("Could not create temporary object file", SourceLocation(1, 1, 0), ec.message());
+        return false;
+    }
+
+    {
+        llvm::raw_fd_ostream out(fd, true);
+        out.write(object.data(), object.size());
+    }
+
+    const std::string objectFile = objectPath.str().str();
+
+    bool linked = false;
+#ifdef SMALLBASIC_HAS_LLD
+    if (const std::optional<bool> lldLinked = link_lld(objectFile, output, *stdPath)) {
+        linked = *lldLinked;
+    } else {
+        linked = link_external(objectFile, output, *stdPath);
+    }
+#else
+    linked = link_external(objectFile, output, *stdPath);
+#endif
+
+    llvm::sys::fs::remove(objectFile);
+    return linked;
+}
+
+bool Linker::link_external(const std::string &object, const std::string &output, const std::string &stdPath) const {
     const std::string compiler = detect_compiler();
-    const std::string stdPath = find_std(pathStd);
+    if (compiler.empty()) {
+        reporter.addError("No supported C++ compilers found in system", SourceLocation(1, 1, 0),
+                          "Recommended: gcc/clang");
+        return false;
+    }
 
-    const std::string command = compiler + " " + object + " " + stdPath + " -o " + output;
-    const int result = std::system(command.c_str());
+    llvm::SmallVector<llvm::StringRef, 8> args = {compiler, object, stdPath};
+    args.append(libraries.begin(), libraries.end());
+    args.append({"-o", output});
+    std::string errorMessage;
+    const int result = llvm::sys::ExecuteAndWait(compiler, args, std::nullopt, {}, 0, 0, &errorMessage);
 
     if (result != 0) {
-        std::exit(result);
+        reporter.addError("Linking with " + compiler + " failed", SourceLocation(1, 1, 0),
+                          result < 0 ? errorMessage : "exit code " + std::to_string(result));
+        return false;
     }
+    return true;
 }
 
+// Returns an empty string if none of the supported compiler drivers is installed.
 std::string Linker::detect_compiler() const {
-    for (const auto &compiler : compilers) {
-#ifdef _WIN32
-        std::string command = compiler + " --version >nul 2>&1";
-#elif __linux__
-        std::string command = compiler + " --version >/dev/null 2>&1";
-#endif
-        if (std::system(command.c_str()) == 0) {
-            return compiler;
+    // resolved once per process and shared by every file of a batch build
+    static const std::string detected = [this] {
+        for (const auto &compiler : compilers) {
+            if (auto path = llvm::sys::findProgramByName(compiler)) {
+                return *path;
+            }
+        }
+        return std::string();
+    }();
+
+    return detected;
+}
+
+#ifdef SMALLBASIC_HAS_LLD
+struct LldToolchain {
+    std::string dynamicLinker;
+    std::filesystem::path crtDir;
+    std::filesystem::path gccDir;
+    std::vector<std::filesystem::path> libDirs;
+};
+
+// Locates the C runtime startup files and gcc support libraries the same way the
+// gcc/clang drivers would, without spawning them.
+static std::optional<LldToolchain> find_lld_toolchain() {
+#ifdef __linux__
+    const llvm::Triple triple(llvm::sys::getDefaultTargetTriple());
+
+    LldToolchain toolchain;
+    switch (triple.getArch()) {
+        case llvm::Triple::x86_64: toolchain.dynamicLinker = "/lib64/ld-linux-x86-64.so.2"; break;
+        case llvm::Triple::aarch64: toolchain.dynamicLinker = "/lib/ld-linux-aarch64.so.1"; break;
+        default: return std::nullopt;
+    }
+
+    const std::string arch = triple.getArchName().str();
+    toolchain.libDirs = {
+        "/usr/lib/" + arch + "-linux-gnu", "/lib/" + arch + "-linux-gnu", "/usr/lib64", "/lib64", "/usr/lib"
+    };
+
+    for (const auto &dir : toolchain.libDirs) {
+        if (std::filesystem::exists(dir / "Scrt1.o")) {
+            toolchain.crtDir = dir;
+            break;
         }
     }
 
-    spdlog::error("No supported C++ compilers found in system. Recommended: gcc/clang");
-    std::exit(1);
+    // newest gcc installation for this architecture, e.g. /usr/lib/gcc/x86_64-linux-gnu/14
+    for (const auto &root : {"/usr/lib/gcc", "/usr/lib64/gcc"}) {
+        std::error_code ec;
+        for (const auto &tripleDir : std::filesystem::directory_iterator(root, ec)) {
+            if (!tripleDir.path().filename().string().starts_with(arch)) continue;
+            for (const auto &versionDir : std::filesystem::directory_iterator(tripleDir.path(), ec)) {
+                const std::string version = versionDir.path().filename().string();
+                if (version.empty() || !std::isdigit(static_cast<unsigned char>(version[0]))) continue;
+                if (!std::filesystem::exists(versionDir.path() / "crtbeginS.o")) continue;
+                if (toolchain.gccDir.empty() || std::stoi(version) > std::stoi(toolchain.gccDir.filename().string())) {
+                    toolchain.gccDir = versionDir.path();
+                }
+            }
+        }
+    }
+
+    if (toolchain.crtDir.empty() || toolchain.gccDir.empty()) {
+        spdlog::debug("C runtime files not found, falling back to external linker");
+        return std::nullopt;
+    }
+
+    return toolchain;
+#else
+    return std::nullopt;
+#endif
+}
+
+// Returns nullopt if LLD can't be used, in which case the external compiler driver is used instead,
+// and otherwise whether the link succeeded.
+std::optional<bool> Linker::link_lld(const std::string &object, const std::string &output, const std::string &stdPath) const {
+    static const std::optional<LldToolchain> toolchain = find_lld_toolchain();
+    if (!toolchain) return std::nullopt;
+
+    // lld keeps global state, so links are serialized and stop once it reports it can't run again
+    static std::mutex lldMutex;
+    static bool canRunAgain = true;
+
+    const std::lock_guard lock(lldMutex);
+    if (!canRunAgain) return std::nullopt;
+
+    std::vector<std::string> args = {
+        "ld.lld", "--eh-frame-hdr", "-pie", "-dynamic-linker", toolchain->dynamicLinker, "-o", output,
+        (toolchain->crtDir / "Scrt1.o").string(), (toolchain->crtDir / "crti.o").string(),
+        (toolchain->gccDir / "crtbeginS.o").string(), "-L" + toolchain->gccDir.string()
+    };
+    for (const auto &dir : toolchain->libDirs) {
+        args.push_back("-L" + dir.string());
+    }
+    args.insert(args.end(), {object, stdPath});
+    args.insert(args.end(), libraries.begin(), libraries.end());
+    args.insert(args.end(), {
+        "-lstdc++", "-lm", "-lgcc_s", "-lgcc", "-lc", "-lgcc_s", "-lgcc",
+        (toolchain->gccDir / "crtendS.o").string(), (toolchain->crtDir / "crtn.o").string()
+    });
+
+    std::vector<const char*> argv;
+    argv.reserve(args.size());
+    for (const auto &arg : args) {
+        argv.push_back(arg.c_str());
+    }
+
+    // lld's messages belong to this file's diagnostics, not to whatever else is writing to stderr
+    std::string messages;
+    llvm::raw_string_ostream messageStream(messages);
+    const lld::Result result = lld::lldMain(argv, messageStream, messageStream, {{lld::Gnu, &lld::elf::link}});
+    canRunAgain = result.canRunAgain;
+
+    if (result.retCode != 0) {
+        reporter.addError("Linking with LLD failed", SourceLocation(1, 1, 0), messages);
+        return false;
+    }
+    return true;
 }
+#endif
 
-std::string Linker::find_std(const std::string &path) {
+std::optional<std::string> Linker::find_std(const std::string &path) {
     std::filesystem::path stdPath;
 
     if (path.empty()) {
@@ -55,8 +223,8 @@ std::string Linker::find_std(const std::string &path) {
 #elif __linux__
         ssize_t count = readlink("/proc/self/exe", pBuf, sizeof(pBuf) - 1);
         if (count == -1) {
-            spdlog::error("Cannot find program directory.");
-            std::exit(1);
+            reporter.addError("Cannot find program directory", SourceLocation(1, 1, 0));
+            return std::nullopt;
         }
         pBuf[count] = '\0';
 #endif
@@ -66,8 +234,8 @@ std::string Linker::find_std(const std::string &path) {
     } else {
         stdPath = path;
         if (!std::filesystem::exists(stdPath)) {
-            spdlog::error("{} doesn't exist", path);
-            std::exit(1);
+            reporter.addError(path + " doesn't exist", SourceLocation(1, 1, 0));
+            return std::nullopt;
         }
     }
 
@@ -75,6 +243,6 @@ std::string Linker::find_std(const std::string &path) {
         return stdPath.string();
     }
 
-    spdlog::error("libSmallBasicLibrary.a not found");
-    std::exit(1);
+    reporter.addError("libSmallBasicLibrary.a not found", SourceLocation(1, 1, 0), "pass its path with --std-path");
+    return std::nullopt;
 }
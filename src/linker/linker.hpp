@@ -4,19 +4,28 @@
 #include <vector>
 #include <optional>
 #include <filesystem>
+#include <llvm/ADT/SmallVector.h>
 #include "../diagnostic.hpp"
 
 class Linker {
 public:
     explicit Linker(DiagnosticReporter &diag);
 
-    void link(const std::string &object, const std::string &output, const std::string &pathStd = "");
+    // Failures are reported to the reporter and make these return false or nullopt.
+    bool link(const llvm::SmallVectorImpl<char> &object, const std::string &output, const std::string &pathStd = "");
+    std::optional<std::string> find_std(const std::string &path);
+    void add_library(const std::string &path);
 
 private:
     DiagnosticReporter& reporter;
 
     std::vector<std::string> compilers;
+    std::vector<std::string> libraries;
 
     std::string detect_compiler() const;
-    std::string find_std(const std::string &path);
+
+    bool link_external(const std::string &object, const std::string &output, const std::string &stdPath) const;
+#ifdef SMALLBASIC_HAS_LLD
+    std::optional<bool> link_lld(const std::string &object, const std::string &output, const std::string &stdPath) const;
+#endif
 };
@@ -7,23 +7,49 @@
 #include <fmt/ranges.h>
 #include <cxxopts.hpp>
 #include <filesystem>
+#include <optional>
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <future>
+#include <thread>
 
 #include "lexer/token.hpp"
 #include "lexer/lexer.hpp"
 #include "diagnostic.hpp"
 #include "parser/parser.hpp"
 #include "semantic/semantic.hpp"
+#include "folding/folding.hpp"
 #include "codegen/codegen.hpp"
 #include "linker/linker.hpp"
+#include "jit/jit.hpp"
+#include "cache/cache.hpp"
+#include "timing/timing.hpp"
+#include "source/source.hpp"
 
-std::string readFile(const std::string &filePath);
+std::optional<std::string> readFile(const std::string &filePath);
 
 void exportTokens(const std::vector<Token>& tokens, const std::string& outFile);
 
-void exportAST(const ASTNode& ast, const std::string& outFile);
+void exportAST(const Program& ast, const std::string& outFile);
 
 std::string getModuleName(const std::string& filename);
 
+// What the compilation cache did while compiling files. Batch builds log above info level, so the
+// counts are summed over all files and reported once the batch is done.
+struct CacheActivity {
+    size_t hits = 0;
+    size_t misses = 0;
+    size_t evictions = 0;
+};
+
+int compile(const std::string& filename, const std::string& outputFile, const cxxopts::ParseResult& result,
+            const std::vector<std::string>& programArgs, std::ostream& diagOut, CacheActivity& cacheActivity);
+
+std::vector<std::string> collectSources(const std::vector<std::string>& inputs);
+
+int compileBatch(const std::vector<std::string>& sources, const cxxopts::ParseResult& result);
+
 int main(int argc, char** argv) {
 #ifdef NDEBUG
     spdlog::set_level(spdlog::level::info);
@@ -32,55 +58,185 @@ int main(int argc, char** argv) {
 #endif
 
     if (argc < 2) {
-        spdlog::error("Usage: {} <source_file> [--export-tokens <file>] [--export-ast <file>] [--output <file>]", argv[0]);
+        spdlog::error("Usage: {} <source_file> [--export-tokens <file>] [--export-ast <file>] [--output <file>] [--run [-- <args>]] [--jobs <n>]", argv[0]);
         return 1;
     }
 
-    std::string filename = argv[1];
-
-    const std::string moduleName = getModuleName(filename);
+    // everything after `--` is passed to the program started by --run
+    int compilerArgc = argc;
+    std::vector<std::string> programArgs;
+    for (int i = 1; i < argc; i++) {
+        if (std::string(argv[i]) == "--") {
+            compilerArgc = i;
+            programArgs.assign(argv + i + 1, argv + argc);
+            break;
+        }
+    }
 
     cxxopts::Options options("SmallBasicLLVM", "LLVM Compiler for SmallBasic");
     options.add_options()
+        ("input", "Source files or directories, - reads from stdin", cxxopts::value<std::vector<std::string>>())
         ("std-path", "Path to libSmallBasicLibrary.a", cxxopts::value<std::string>())
         ("export-tokens", "Export tokens to file", cxxopts::value<std::string>())
         ("export-ast", "Export AST to file", cxxopts::value<std::string>())
         ("export-ir", "Export LLVM IR to file", cxxopts::value<std::string>())
-#ifdef _WIN32
-    ("o,output", "Output file", cxxopts::value<std::string>()->default_value(moduleName + ".exe"))
-#elif __linux__
-    ("o,output", "Output file", cxxopts::value<std::string>()->default_value(moduleName))
-#endif
+        ("run", "JIT compile and run the program instead of producing an executable")
+        ("cache-dir", "Reuse executables from a compilation cache in this directory", cxxopts::value<std::string>())
+        ("cache-size", "Maximum compilation cache size in MiB", cxxopts::value<size_t>()->default_value("512"))
+        ("profile-counts", "Count statement executions and write <source>.profile.txt when the program exits")
+        ("profile-sampling", "Allow sampling the program with SIGPROF; set SMALLBASIC_PROFILE=<file> when running it")
+        ("profile-generate", "Instrument the program to write LLVM profile data when it exits",
+            cxxopts::value<std::string>()->implicit_value("default_%m.profraw"))
+        ("profile-use", "Optimize using profile data merged with llvm-profdata", cxxopts::value<std::string>())
+        ("time-report", "Report time and memory per compiler phase (text or json)",
+            cxxopts::value<std::string>()->implicit_value("text"))
+        ("j,jobs", "Number of files compiled in parallel in batch mode", cxxopts::value<unsigned>())
+        ("o,output", "Output file, or output directory in batch mode", cxxopts::value<std::string>())
         ("h,help", "Print usage");
+    options.parse_positional({"input"});
+    options.positional_help("<source_file>...");
 
-    auto result = options.parse(argc - 1, argv + 1);
+    auto result = options.parse(compilerArgc, argv);
 
     if (result.count("help")) {
         std::cout << options.help() << std::endl;
         return 0;
     }
 
+    if (!result.count("input")) {
+        spdlog::error("No source file given");
+        return 1;
+    }
+
+    const auto& inputs = result["input"].as<std::vector<std::string>>();
+
     spdlog::info(" --- SmallBasicLLVM Compiler {} ---", VERSION);
 
-    std::string source = readFile(filename);
-    DiagnosticReporter diag(source, filename);
+    if (inputs.size() == 1 && !std::filesystem::is_directory(inputs.front())) {
+        const std::string& filename = inputs.front();
+        const std::string moduleName = getModuleName(filename);
 
-    spdlog::info("[1/5] Lexing");
+#ifdef _WIN32
+        std::string outputFile = moduleName + ".exe";
+#elif __linux__
+        std::string outputFile = moduleName;
+#endif
+        if (result.count("output")) {
+            outputFile = result["output"].as<std::string>();
+        }
 
-    Lexer lexer;
-    const std::vector<Token> tokens = lexer.tokenize(source, diag);
+        CacheActivity cacheActivity;
+        return compile(filename, outputFile, result, programArgs, std::cerr, cacheActivity);
+    }
 
-    diag.printDiagnostics();
-    if (diag.hasErrorsOccurred()) return 1;
+    if (result.count("run") || result.count("export-tokens") || result.count("export-ast") ||
+        result.count("export-ir") || result.count("time-report") || result.count("profile-use")) {
+        spdlog::error("--run, --export-*, --time-report and --profile-use accept a single source file");
+        return 1;
+    }
+
+    return compileBatch(collectSources(inputs), result);
+}
+
+int compile(const std::string& filename, const std::string& outputFile, const cxxopts::ParseResult& result,
+            const std::vector<std::string>& programArgs, std::ostream& diagOut, CacheActivity& cacheActivity) {
+    const std::string moduleName = getModuleName(filename);
+
+    TimeReport timeReport(result.count("time-report") > 0,
+                          result.count("time-report") && result["time-report"].as<std::string>() == "json"
+                              ? TimeReportFormat::Json : TimeReportFormat::Text);
+
+    auto sourceFile = timeReport.measure("Reading source", [&] { return SourceFile::read(filename); });
+    if (!sourceFile) {
+        DiagnosticReporter readDiag({}, filename, diagOut);
+        readDiag.addError("Could not open file", SourceLocation(1, 1, 0), llvm::toString(sourceFile.takeError()));
+        readDiag.printDiagnostics();
+        return 1;
+    }
+
+    const std::string_view source = sourceFile->text();
+    DiagnosticReporter diag(source, filename, diagOut);
+
+    const std::string stdPathOption = result.count("std-path") ? result["std-path"].as<std::string>() : "";
+
+    PGOMode pgoMode = PGOMode::None;
+    std::string profileFile;
+    if (result.count("profile-generate") && result.count("profile-use")) {
+        spdlog::error("--profile-generate and --profile-use can't be combined");
+        return 1;
+    }
+    if (result.count("profile-generate")) {
+#ifndef SMALLBASIC_PROFILE_RUNTIME
+        spdlog::error("--profile-generate needs libclang_rt.profile, which was not found when building the compiler");
+        return 1;
+#endif
+        if (result.count("run")) {
+            spdlog::error("--profile-generate can't be used with --run");
+            return 1;
+        }
+        pgoMode = PGOMode::Generate;
+        profileFile = result["profile-generate"].as<std::string>();
+    } else if (result.count("profile-use")) {
+        pgoMode = PGOMode::Use;
+        profileFile = result["profile-use"].as<std::string>();
+    }
+
+    // exports and --run need the intermediate phases, so only plain builds go through the cache
+    std::optional<CompilationCache> cache;
+    std::string cacheKey;
+    if (result.count("cache-dir") && !result.count("run") && !result.count("export-tokens") &&
+        !result.count("export-ast") && !result.count("export-ir")) {
+        cache.emplace(result["cache-dir"].as<std::string>(), result["cache-size"].as<size_t>() * 1024 * 1024);
+
+        Linker linker(diag);
+        std::vector<std::string> flags;
+        if (result.count("profile-counts")) flags.emplace_back("--profile-counts");
+        if (result.count("profile-sampling")) flags.emplace_back("--profile-sampling");
+        if (pgoMode == PGOMode::Generate) flags.emplace_back("--profile-generate=" + profileFile);
+        // the profile contents decide the optimized code, not its path
+        if (pgoMode == PGOMode::Use) {
+            const std::optional<std::string> profile = readFile(profileFile);
+            if (!profile) {
+                diag.addError("Could not open file: " + profileFile, SourceLocation(1, 1, 0));
+                diag.printDiagnostics();
+                return 1;
+            }
+            flags.emplace_back("--profile-use=" + *profile);
+        }
+
+        const std::optional<std::string> stdPath = linker.find_std(stdPathOption);
+        if (!stdPath) {
+            diag.printDiagnostics();
+            return 1;
+        }
+
+        cacheKey = timeReport.measure("Cache key", [&] {
+            return CompilationCache::computeKey(source, *stdPath, flags);
+        });
+
+        if (timeReport.measure("Cache lookup", [&] { return cache->fetch(cacheKey, outputFile); })) {
+            cacheActivity.hits++;
+            timeReport.print(std::cerr, filename);
+            spdlog::info("Compiled {}.sb!", moduleName);
+            return 0;
+        }
+        cacheActivity.misses++;
+    }
 
     if (result.count("export-tokens")) {
-        exportTokens(tokens, result["export-tokens"].as<std::string>());
+        // the parser pulls tokens on demand, so exporting them is a separate pass; its
+        // diagnostics are reported by the parsing pass below
+        std::ostringstream ignored;
+        DiagnosticReporter exportDiag(source, filename, ignored);
+        exportTokens(Lexer().tokenize(source, exportDiag), result["export-tokens"].as<std::string>());
     }
 
-    spdlog::info("[2/5] Parsing");
+    spdlog::info("[1/4] Parsing");
 
-    Parser parser(tokens, diag);
-    auto ast = parser.parse();
+    Lexer lexer;
+    lexer.start(source, diag);
+    Parser parser(lexer, diag);
+    auto ast = timeReport.measure("Lexing and parsing", [&] { return parser.parse(); });
 
     if (!ast) {
         diag.addError("Parsing failed!", SourceLocation(1, 1, 0));
@@ -100,19 +256,28 @@ int main(int argc, char** argv) {
     diag.printDiagnostics();
     if (diag.hasErrorsOccurred()) return 1;
 
-    spdlog::info("[3/5] Analyzing");
+    spdlog::info("[2/4] Analyzing");
 
     SemanticAnalyzer analyzer(diag);
-    analyzer.analyze(*ast);
+    timeReport.measure("Semantic analysis", [&] { analyzer.analyze(*ast); });
 
     diag.printDiagnostics();
     if (diag.hasErrorsOccurred()) return 1;
 
-    spdlog::info("[4/5] Codegen");
+    ConstantFolder folder;
+    timeReport.measure("Constant folding", [&] { folder.fold(*ast); });
+
+    spdlog::info("[3/4] Codegen");
 
     CodeGenerator codegen(diag);
+    if (result.count("profile-counts")) {
+        codegen.enableProfileCounts(std::filesystem::absolute(filename).string());
+    }
+    if (result.count("profile-sampling")) {
+        codegen.enableProfileSampling(std::filesystem::absolute(filename).string());
+    }
 
-    if (!codegen.generate(*ast, moduleName)) {
+    if (!timeReport.measure("IR generation", [&] { return codegen.generate(*ast, moduleName); })) {
         diag.printDiagnostics();
         return 1;
     }
@@ -120,35 +285,166 @@ int main(int argc, char** argv) {
     diag.printDiagnostics();
     if (diag.hasErrorsOccurred()) return 1;
 
-    auto outputFile = result["output"].as<std::string>();
+    if (pgoMode != PGOMode::None &&
+        !timeReport.measure("Optimization", [&] { return codegen.optimize(pgoMode, profileFile); })) {
+        diag.printDiagnostics();
+        return 1;
+    }
 
     if (result.count("export-ir")) {
         codegen.emitIR(result["export-ir"].as<std::string>());
     }
 
-    auto objectFile = moduleName + ".o";
-    codegen.emitObjectFile(objectFile);
+    if (result.count("run")) {
+        spdlog::info("[4/4] Running");
+        timeReport.print(std::cerr, filename);
+
+        JIT jit(diag);
+        const std::optional<int> exitCode = jit.run(codegen.takeContext(), codegen.takeModule(), filename, programArgs);
+        if (!exitCode) {
+            diag.printDiagnostics();
+            return 1;
+        }
+        return *exitCode;
+    }
+
+    llvm::SmallVector<char, 0> object;
+    if (!timeReport.measure("Object emission", [&] { return codegen.emitObject(object); })) {
+        diag.printDiagnostics();
+        return 1;
+    }
 
-    spdlog::info("[5/5] Linking");
+    spdlog::info("[4/4] Linking");
 
     Linker linker(diag);
-    if (result.count("std-path")) {
-        linker.link(objectFile, outputFile, result["std-path"].as<std::string>());
-    } else {
-        linker.link(objectFile, outputFile);
+#ifdef SMALLBASIC_PROFILE_RUNTIME
+    if (pgoMode == PGOMode::Generate) {
+        linker.add_library(SMALLBASIC_PROFILE_RUNTIME);
+    }
+#endif
+    if (!timeReport.measure("Linking", [&] { return linker.link(object, outputFile, stdPathOption); })) {
+        diag.printDiagnostics();
+        return 1;
+    }
+
+    if (cache) {
+        cacheActivity.evictions += timeReport.measure("Cache store", [&] { return cache->store(cacheKey, outputFile); });
     }
 
-    std::filesystem::remove(objectFile);
+    timeReport.print(std::cerr, filename);
 
     spdlog::info("Compiled {}.sb!", moduleName);
     return 0;
 }
 
-std::string readFile(const std::string &filePath) {
+std::vector<std::string> collectSources(const std::vector<std::string>& inputs) {
+    std::vector<std::string> sources;
+    for (const auto& input : inputs) {
+        if (!std::filesystem::is_directory(input)) {
+            sources.push_back(input);
+            continue;
+        }
+
+        std::vector<std::string> found;
+        for (const auto& entry : std::filesystem::recursive_directory_iterator(input)) {
+            if (entry.is_regular_file() && entry.path().extension() == ".sb") {
+                found.push_back(entry.path().string());
+            }
+        }
+        std::ranges::sort(found);
+        sources.insert(sources.end(), found.begin(), found.end());
+    }
+    return sources;
+}
+
+int compileBatch(const std::vector<std::string>& sources, const cxxopts::ParseResult& result) {
+    struct BatchResult {
+        int exitCode;
+        std::string diagnostics;
+        CacheActivity cacheActivity;
+    };
+
+    const unsigned jobs = result.count("jobs") ? std::max(1u, result["jobs"].as<unsigned>())
+                                               : std::max(1u, std::thread::hardware_concurrency());
+
+    spdlog::info("Compiling {} files with {} jobs", sources.size(), jobs);
+
+    std::vector<std::string> outputs;
+    std::map<std::string, size_t> outputSources;
+    for (const auto& source : sources) {
+        const std::filesystem::path path(source);
+
+#ifdef _WIN32
+        const std::string executable = path.stem().string() + ".exe";
+#elif __linux__
+        const std::string executable = path.stem().string();
+#endif
+        const std::filesystem::path outputDir = result.count("output")
+            ? std::filesystem::path(result["output"].as<std::string>())
+            : path.parent_path();
+        outputs.push_back((outputDir / executable).lexically_normal().string());
+
+        // workers linking the same output would overwrite each other's executables
+        if (const auto [it, inserted] = outputSources.emplace(outputs.back(), outputs.size() - 1); !inserted) {
+            spdlog::error("{} and {} would both be compiled to {}", sources[it->second], source, outputs.back());
+            return 1;
+        }
+    }
+
+    // per-phase progress from concurrent workers would interleave, results are reported below in input order
+    const auto level = spdlog::get_level();
+    spdlog::set_level(std::max(level, spdlog::level::warn));
+
+    std::vector<std::promise<BatchResult>> promises(sources.size());
+    std::atomic<size_t> next = 0;
+
+    const auto worker = [&] {
+        for (size_t i = next++; i < sources.size(); i = next++) {
+            std::ostringstream diagnostics;
+            CacheActivity cacheActivity;
+            const int exitCode = compile(sources[i], outputs[i], result, {}, diagnostics, cacheActivity);
+            promises[i].set_value({exitCode, diagnostics.str(), cacheActivity});
+        }
+    };
+
+    if (result.count("output")) {
+        std::filesystem::create_directories(result["output"].as<std::string>());
+    }
+
+    std::vector<std::jthread> workers;
+    for (unsigned i = 0; i < std::min<size_t>(jobs, sources.size()); i++) {
+        workers.emplace_back(worker);
+    }
+
+    size_t failed = 0;
+    CacheActivity cacheTotal;
+    for (size_t i = 0; i < sources.size(); i++) {
+        const auto [exitCode, diagnostics, cacheActivity] = promises[i].get_future().get();
+        std::cerr << diagnostics;
+        cacheTotal.hits += cacheActivity.hits;
+        cacheTotal.misses += cacheActivity.misses;
+        cacheTotal.evictions += cacheActivity.evictions;
+
+        if (exitCode != 0) {
+            failed++;
+            spdlog::error("Failed {}", sources[i]);
+        } else {
+            std::cout << "Compiled " << sources[i] << (cacheActivity.hits ? " (cached)" : "") << std::endl;
+        }
+    }
+
+    spdlog::set_level(level);
+    spdlog::info("Compiled {}/{} files", sources.size() - failed, sources.size());
+    if (result.count("cache-dir")) {
+        spdlog::info("Cache: {} hits, {} misses, {} evictions", cacheTotal.hits, cacheTotal.misses, cacheTotal.evictions);
+    }
+    return failed == 0 ? 0 : 1;
+}
+
+std::optional<std::string> readFile(const std::string &filePath) {
     std::ifstream file(filePath);
     if (!file.is_open()) {
-        spdlog::error("Could not open file: {}", filePath);
-        exit(1);
+        return std::nullopt;
     }
     std::stringstream buffer;
     buffer << file.rdbuf();
@@ -156,6 +452,7 @@ std::string readFile(const std::string &filePath) {
 }
 
 std::string getModuleName(const std::string& filename) {
+    if (filename == "-") return "stdin";
     const std::filesystem::path p(filename);
     return p.stem().string();
 }
@@ -172,7 +469,7 @@ void exportTokens(const std::vector<Token>& tokens, const std::string& outFile)
     }
 }
 
-void exportAST(const ASTNode& ast, const std::string& outFile) {
+void exportAST(const Program& ast, const std::string& outFile) {
     std::ofstream file(outFile);
     if (!file.is_open()) {
         spdlog::error("Could not open file for writing AST: {}", outFile);
@@ -0,0 +1,75 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <span>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Bump allocator owning every AST node of a Program. Nodes are never destroyed one by one, so only
+// trivially destructible types may live here; the tree is released with the arena's few blocks.
+class Arena {
+public:
+    Arena() = default;
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    template <typename T, typename... Args>
+    T* make(Args&&... args) {
+        static_assert(std::is_trivially_destructible_v<T>, "arena objects are never destroyed");
+        return new (this->allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+    }
+
+    template <typename T>
+    std::span<const T> copy(const std::span<const T> items) {
+        static_assert(std::is_trivially_copyable_v<T>, "arena arrays are copied bytewise");
+        if (items.empty()) return {};
+        auto* data = static_cast<T*>(this->allocate(items.size_bytes(), alignof(T)));
+        std::memcpy(data, items.data(), items.size_bytes());
+        return {data, items.size()};
+    }
+
+    std::string_view copy(const std::string_view text) {
+        if (text.empty()) return {};
+        auto* data = static_cast<char*>(this->allocate(text.size(), 1));
+        std::memcpy(data, text.data(), text.size());
+        return {data, text.size()};
+    }
+
+    [[nodiscard]] size_t bytesReserved() const { return this->reserved; }
+
+private:
+    static constexpr size_t firstBlockSize = 64 * 1024;
+    static constexpr size_t maxBlockSize = 4 * 1024 * 1024;
+
+    std::vector<std::unique_ptr<std::byte[]>> blocks;
+    std::byte* cursor = nullptr;
+    std::byte* limit = nullptr;
+    size_t reserved = 0;
+
+    void* allocate(const size_t size, const size_t align) {
+        auto* aligned = reinterpret_cast<std::byte*>(
+            (reinterpret_cast<uintptr_t>(this->cursor) + align - 1) & ~(uintptr_t{align} - 1));
+        if (!this->cursor || aligned + size > this->limit) {
+            this->grow(size + align);
+            aligned = reinterpret_cast<std::byte*>(
+                (reinterpret_cast<uintptr_t>(this->cursor) + align - 1) & ~(uintptr_t{align} - 1));
+        }
+        this->cursor = aligned + size;
+        return aligned;
+    }
+
+    // blocks double up to maxBlockSize, so large programs need only a handful of them
+    void grow(const size_t minimum) {
+        const size_t size = std::max(minimum, std::min(maxBlockSize, firstBlockSize << std::min<size_t>(this->blocks.size(), 6)));
+        this->blocks.push_back(std::make_unique_for_overwrite<std::byte[]>(size));
+        this->cursor = this->blocks.back().get();
+        this->limit = this->cursor + size;
+        this->reserved += size;
+    }
+};
@@ -1,17 +1,52 @@
 #pragma once
-#include <memory>
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <ostream>
+#include <span>
+#include <string>
+#include <string_view>
+#include <type_traits>
 #include <vector>
+#include "arena.hpp"
+#include "symbols.hpp"
+#include "../diagnostic.hpp"
+
+enum class NodeKind : uint8_t {
+    NumberLiteral,
+    StringLiteral,
+    Identifier,
+    ArrayAccess,
+    PropertyAccess,
+    BinaryExpression,
+    UnaryExpression,
+    CallExpression,
+
+    AssignmentStatement,
+    ExpressionStatement,
+    IfStatement,
+    WhileStatement,
+    ForStatement,
+    GotoStatement,
+    LabelStatement,
+    SubroutineStatement,
+};
 
+// Nodes are allocated in their Program's arena and refer to each other by plain pointers. Names
+// are symbol ids and positions are byte offsets into the source; Program::location turns an
+// offset back into a line and column. Nodes carry no vtable: passes dispatch on kind through
+// visit() and test for a node type with nodeCast().
 class ASTNode {
 public:
-    size_t line;
-    size_t column;
+    NodeKind kind;
+    uint32_t offset;
 
-    ASTNode(const size_t l, const size_t c) : line(l), column(c) {}
-    virtual ~ASTNode() = default;
-    virtual void print(std::ostream& out, int indent = 0) const = 0;
+    ASTNode(const NodeKind k, const uint32_t o) : kind(k), offset(o) {}
+    void print(std::ostream& out, const SymbolTable& symbols, int indent = 0) const;
 
 protected:
+    ~ASTNode() = default;
+
     std::string getIndent(const int indent) const {
         return std::string(indent * 2, ' ');
     }
@@ -19,61 +54,74 @@ protected:
 
 class Expression : public ASTNode {
 public:
-    Expression(const size_t l, const size_t c) : ASTNode(l, c) {}
+    Expression(const NodeKind k, const uint32_t o) : ASTNode(k, o) {}
 };
 
+class Statement;
+
+using ExpressionList = std::span<Expression* const>;
+using StatementList = std::span<Statement* const>;
+
 class NumberLiteral final : public Expression {
 public:
+    static constexpr NodeKind Kind = NodeKind::NumberLiteral;
+
     double value;
 
-    NumberLiteral(const double val, const size_t l, const size_t c)
-        : Expression(l, c), value(val) {}
+    NumberLiteral(const double val, const uint32_t o)
+        : Expression(Kind, o), value(val) {}
 
-    void print(std::ostream& out, int indent = 0) const override;
+    void print(std::ostream& out, const SymbolTable& symbols, int indent = 0) const;
 };
 
 class StringLiteral final : public Expression {
 public:
-    std::string value;
+    static constexpr NodeKind Kind = NodeKind::StringLiteral;
 
-    StringLiteral(std::string val, const size_t l, const size_t c)
-        : Expression(l, c), value(std::move(val)) {}
+    std::string_view value; // stored in the arena
 
-    void print(std::ostream& out, int indent = 0) const override;
+    StringLiteral(const std::string_view val, const uint32_t o)
+        : Expression(Kind, o), value(val) {}
+
+    void print(std::ostream& out, const SymbolTable& symbols, int indent = 0) const;
 };
 
 class Identifier final : public Expression {
 public:
-    std::string name;
+    static constexpr NodeKind Kind = NodeKind::Identifier;
+
+    SymbolId name;
 
-    Identifier(std::string n, const size_t l, const size_t c)
-        : Expression(l, c), name(std::move(n)) {}
+    Identifier(const SymbolId n, const uint32_t o)
+        : Expression(Kind, o), name(n) {}
 
-    void print(std::ostream& out, int indent = 0) const override;
+    void print(std::ostream& out, const SymbolTable& symbols, int indent = 0) const;
 };
 
 class ArrayAccess final : public Expression {
 public:
-    std::unique_ptr<Expression> array;
-    std::unique_ptr<Expression> index;
+    static constexpr NodeKind Kind = NodeKind::ArrayAccess;
+
+    Expression* array;
+    Expression* index;
 
-    ArrayAccess(std::unique_ptr<Expression> arr, std::unique_ptr<Expression> idx,
-                const size_t l, const size_t c)
-        : Expression(l, c), array(std::move(arr)), index(std::move(idx)) {}
+    ArrayAccess(Expression* arr, Expression* idx, const uint32_t o)
+        : Expression(Kind, o), array(arr), index(idx) {}
 
-    void print(std::ostream& out, int indent = 0) const override;
+    void print(std::ostream& out, const SymbolTable& symbols, int indent = 0) const;
 };
 
 class PropertyAccess final : public Expression {
 public:
-    std::unique_ptr<Expression> object;
-    std::string property;
+    static constexpr NodeKind Kind = NodeKind::PropertyAccess;
 
-    PropertyAccess(std::unique_ptr<Expression> obj, std::string prop,
-                   const size_t l, const size_t c)
-        : Expression(l, c), object(std::move(obj)), property(std::move(prop)) {}
+    Expression* object;
+    SymbolId property;
 
-    void print(std::ostream& out, int indent = 0) const override;
+    PropertyAccess(Expression* obj, const SymbolId prop, const uint32_t o)
+        : Expression(Kind, o), object(obj), property(prop) {}
+
+    void print(std::ostream& out, const SymbolTable& symbols, int indent = 0) const;
 };
 
 enum class BinaryOp {
@@ -85,149 +133,253 @@ enum class BinaryOp {
 
 class BinaryExpression final : public Expression {
 public:
+    static constexpr NodeKind Kind = NodeKind::BinaryExpression;
+
     BinaryOp op;
-    std::unique_ptr<Expression> left;
-    std::unique_ptr<Expression> right;
+    Expression* left;
+    Expression* right;
 
-    BinaryExpression(const BinaryOp operation, std::unique_ptr<Expression> l,
-                     std::unique_ptr<Expression> r, const size_t line, const size_t col)
-        : Expression(line, col), op(operation), left(std::move(l)), right(std::move(r)) {}
+    BinaryExpression(const BinaryOp operation, Expression* l, Expression* r, const uint32_t o)
+        : Expression(Kind, o), op(operation), left(l), right(r) {}
 
-    
-    void print(std::ostream& out, int indent = 0) const override;
+    void print(std::ostream& out, const SymbolTable& symbols, int indent = 0) const;
 };
 
 class UnaryExpression final : public Expression {
 public:
-    std::unique_ptr<Expression> operand;
+    static constexpr NodeKind Kind = NodeKind::UnaryExpression;
 
-    UnaryExpression(std::unique_ptr<Expression> opd, const size_t l, const size_t c)
-        : Expression(l, c), operand(std::move(opd)) {}
+    Expression* operand;
 
-    
-    void print(std::ostream& out, int indent = 0) const override;
+    UnaryExpression(Expression* opd, const uint32_t o)
+        : Expression(Kind, o), operand(opd) {}
+
+    void print(std::ostream& out, const SymbolTable& symbols, int indent = 0) const;
 };
 
 class CallExpression final : public Expression {
 public:
-    std::unique_ptr<Expression> callee;
-    std::vector<std::unique_ptr<Expression>> arguments;
+    static constexpr NodeKind Kind = NodeKind::CallExpression;
+
+    Expression* callee;
+    ExpressionList arguments;
 
-    CallExpression(std::unique_ptr<Expression> c,
-                   std::vector<std::unique_ptr<Expression>> args,
-                   const size_t l, const size_t col)
-        : Expression(l, col), callee(std::move(c)), arguments(std::move(args)) {}
+    CallExpression(Expression* c, const ExpressionList args, const uint32_t o)
+        : Expression(Kind, o), callee(c), arguments(args) {}
 
-    
-    void print(std::ostream& out, int indent = 0) const override;
+    void print(std::ostream& out, const SymbolTable& symbols, int indent = 0) const;
 };
 
 class Statement : public ASTNode {
 public:
-    Statement(const size_t l, const size_t c) : ASTNode(l, c) {}
+    Statement(const NodeKind k, const uint32_t o) : ASTNode(k, o) {}
 };
 
-class AssignmentStatement : public Statement {
+class AssignmentStatement final : public Statement {
 public:
-    std::unique_ptr<Expression> target;
-    std::unique_ptr<Expression> value;
+    static constexpr NodeKind Kind = NodeKind::AssignmentStatement;
+
+    Expression* target;
+    Expression* value;
 
-    AssignmentStatement(std::unique_ptr<Expression> tgt, std::unique_ptr<Expression> val,
-                        const size_t l, const size_t c)
-        : Statement(l, c), target(std::move(tgt)), value(std::move(val)) {}
+    AssignmentStatement(Expression* tgt, Expression* val, const uint32_t o)
+        : Statement(Kind, o), target(tgt), value(val) {}
 
-    void print(std::ostream& out, int indent = 0) const override;
+    void print(std::ostream& out, const SymbolTable& symbols, int indent = 0) const;
 };
 
 class ExpressionStatement final : public Statement {
 public:
-    std::unique_ptr<Expression> expression;
+    static constexpr NodeKind Kind = NodeKind::ExpressionStatement;
 
-    ExpressionStatement(std::unique_ptr<Expression> expr, const size_t l, const size_t c)
-        : Statement(l, c), expression(std::move(expr)) {}
+    Expression* expression;
 
-    void print(std::ostream& out, int indent = 0) const override;
+    ExpressionStatement(Expression* expr, const uint32_t o)
+        : Statement(Kind, o), expression(expr) {}
+
+    void print(std::ostream& out, const SymbolTable& symbols, int indent = 0) const;
+};
+
+struct ElseIfBlock {
+    Expression* condition;
+    StatementList block;
 };
 
 class IfStatement final : public Statement {
 public:
-    std::unique_ptr<Expression> condition;
-    std::vector<std::unique_ptr<Statement>> thenBlock;
-    std::vector<std::pair<std::unique_ptr<Expression>,
-                          std::vector<std::unique_ptr<Statement>>>> elseIfBlocks;
-    std::vector<std::unique_ptr<Statement>> elseBlock;
+    static constexpr NodeKind Kind = NodeKind::IfStatement;
+
+    Expression* condition;
+    StatementList thenBlock;
+    std::span<const ElseIfBlock> elseIfBlocks;
+    StatementList elseBlock;
 
-    IfStatement(std::unique_ptr<Expression> cond, const size_t l, const size_t c)
-        : Statement(l, c), condition(std::move(cond)) {}
+    IfStatement(Expression* cond, const uint32_t o)
+        : Statement(Kind, o), condition(cond) {}
 
-    void print(std::ostream& out, int indent = 0) const override;
+    void print(std::ostream& out, const SymbolTable& symbols, int indent = 0) const;
 };
 
 class WhileStatement final : public Statement {
 public:
-    std::unique_ptr<Expression> condition;
-    std::vector<std::unique_ptr<Statement>> body;
+    static constexpr NodeKind Kind = NodeKind::WhileStatement;
 
-    WhileStatement(std::unique_ptr<Expression> cond, const size_t l, const size_t c)
-        : Statement(l, c), condition(std::move(cond)) {}
+    Expression* condition;
+    StatementList body;
 
-    void print(std::ostream& out, int indent = 0) const override;
+    WhileStatement(Expression* cond, const uint32_t o)
+        : Statement(Kind, o), condition(cond) {}
+
+    void print(std::ostream& out, const SymbolTable& symbols, int indent = 0) const;
 };
 
 class ForStatement final : public Statement {
 public:
-    std::string variable;
-    std::unique_ptr<Expression> start;
-    std::unique_ptr<Expression> end;
-    std::unique_ptr<Expression> step;
-    std::vector<std::unique_ptr<Statement>> body;
+    static constexpr NodeKind Kind = NodeKind::ForStatement;
+
+    SymbolId variable;
+    Expression* start;
+    Expression* end;
+    Expression* step; // null without a Step clause
+    StatementList body;
 
-    ForStatement(std::string var, std::unique_ptr<Expression> s,
-                 std::unique_ptr<Expression> e, std::unique_ptr<Expression> st,
-                 const size_t l, const size_t c)
-        : Statement(l, c), variable(std::move(var)), start(std::move(s)),
-          end(std::move(e)), step(std::move(st)) {}
+    ForStatement(const SymbolId var, Expression* s, Expression* e, Expression* st, const uint32_t o)
+        : Statement(Kind, o), variable(var), start(s), end(e), step(st) {}
 
-    void print(std::ostream& out, int indent = 0) const override;
+    void print(std::ostream& out, const SymbolTable& symbols, int indent = 0) const;
 };
 
-class GotoStatement : public Statement {
+class GotoStatement final : public Statement {
 public:
-    std::string label;
+    static constexpr NodeKind Kind = NodeKind::GotoStatement;
 
-    GotoStatement(std::string lbl, const size_t l, const size_t c)
-        : Statement(l, c), label(std::move(lbl)) {}
+    SymbolId label;
 
-    void print(std::ostream& out, int indent = 0) const override;
+    GotoStatement(const SymbolId lbl, const uint32_t o)
+        : Statement(Kind, o), label(lbl) {}
+
+    void print(std::ostream& out, const SymbolTable& symbols, int indent = 0) const;
 };
 
 class LabelStatement final : public Statement {
 public:
-    std::string name;
+    static constexpr NodeKind Kind = NodeKind::LabelStatement;
+
+    SymbolId name;
 
-    LabelStatement(std::string n, const size_t l, const size_t c)
-        : Statement(l, c), name(std::move(n)) {}
+    LabelStatement(const SymbolId n, const uint32_t o)
+        : Statement(Kind, o), name(n) {}
 
-    void print(std::ostream& out, int indent = 0) const override;
+    void print(std::ostream& out, const SymbolTable& symbols, int indent = 0) const;
 };
 
 class SubroutineStatement final : public Statement {
 public:
-    std::string name;
-    std::vector<std::unique_ptr<Statement>> body;
+    static constexpr NodeKind Kind = NodeKind::SubroutineStatement;
+
+    SymbolId name;
+    StatementList body;
+
+    SubroutineStatement(const SymbolId n, const uint32_t o)
+        : Statement(Kind, o), name(n) {}
+
+    void print(std::ostream& out, const SymbolTable& symbols, int indent = 0) const;
+};
+
+template <typename From, typename To>
+using LikeConst = std::conditional_t<std::is_const_v<From>, const To, To>;
+
+// Returns node as a T if that is its concrete type, otherwise null. A single kind compare.
+template <typename T, typename Node>
+LikeConst<Node, T>* nodeCast(Node* node) {
+    return node && node->kind == T::Kind ? static_cast<LikeConst<Node, T>*>(node) : nullptr;
+}
+
+// Calls visitor with node cast to its concrete type. Only the node types that can sit behind a
+// Node& are dispatched to, so a visitor over Statement& needs no overloads for expressions.
+template <typename Node, typename Visitor>
+decltype(auto) visit(Node& node, Visitor&& visitor) {
+    using Base = std::remove_const_t<Node>;
+#define SMALLBASIC_VISIT_CASE(Type) \
+    case NodeKind::Type: \
+        if constexpr (std::is_base_of_v<Base, Type>) { \
+            return visitor(static_cast<LikeConst<Node, Type>&>(node)); \
+        } \
+        break;
+
+    switch (node.kind) {
+        SMALLBASIC_VISIT_CASE(NumberLiteral)
+        SMALLBASIC_VISIT_CASE(StringLiteral)
+        SMALLBASIC_VISIT_CASE(Identifier)
+        SMALLBASIC_VISIT_CASE(ArrayAccess)
+        SMALLBASIC_VISIT_CASE(PropertyAccess)
+        SMALLBASIC_VISIT_CASE(BinaryExpression)
+        SMALLBASIC_VISIT_CASE(UnaryExpression)
+        SMALLBASIC_VISIT_CASE(CallExpression)
+        SMALLBASIC_VISIT_CASE(AssignmentStatement)
+        SMALLBASIC_VISIT_CASE(ExpressionStatement)
+        SMALLBASIC_VISIT_CASE(IfStatement)
+        SMALLBASIC_VISIT_CASE(WhileStatement)
+        SMALLBASIC_VISIT_CASE(ForStatement)
+        SMALLBASIC_VISIT_CASE(GotoStatement)
+        SMALLBASIC_VISIT_CASE(LabelStatement)
+        SMALLBASIC_VISIT_CASE(SubroutineStatement)
+    }
+#undef SMALLBASIC_VISIT_CASE
+
+    // a node's kind always names a type derived from its static type
+#ifdef _MSC_VER
+    __assume(false);
+#else
+    __builtin_unreachable();
+#endif
+}
+
+// Builds a visitor from one lambda per node type, with a generic lambda as a fallback.
+template <typename... Handlers>
+struct Overloaded : Handlers... {
+    using Handlers::operator()...;
+};
+
+// Maps source offsets to lines. The parser records where each line holding a token starts, and
+// every node sits on a token, so a binary search over those starts finds any node's line.
+class LineTable {
+public:
+    void add(const size_t line, const size_t lineStart) {
+        if (this->lines.empty() || line > this->lines.back().line) {
+            this->lines.push_back({static_cast<uint32_t>(lineStart), static_cast<uint32_t>(line)});
+        }
+    }
+
+    [[nodiscard]] SourceLocation locate(const uint32_t offset, const size_t length = 1) const {
+        const auto it = std::ranges::upper_bound(this->lines, offset, {}, &LineStart::offset);
+        if (it == this->lines.begin()) return {1, offset, length};
+        return {std::prev(it)->line, offset - std::prev(it)->offset, length};
+    }
 
-    SubroutineStatement(std::string n, const size_t l, const size_t c)
-        : Statement(l, c), name(std::move(n)) {}
+private:
+    struct LineStart {
+        uint32_t offset;
+        uint32_t line;
+    };
 
-    
-    void print(std::ostream& out, int indent = 0) const override;
+    std::vector<LineStart> lines;
 };
 
-class Program final : public ASTNode {
+class Program final {
 public:
-    std::vector<std::unique_ptr<Statement>> statements;
+    Arena arena;
+    SymbolTable symbols{arena};
+    LineTable lines;
+    StatementList statements;
 
-    Program() : ASTNode(1, 1) {}
+    [[nodiscard]] SourceLocation location(const ASTNode& node, const size_t length = 1) const {
+        return this->lines.locate(node.offset, length);
+    }
+
+    [[nodiscard]] std::string name(const SymbolId id) const {
+        return std::string(this->symbols.name(id));
+    }
 
-    void print(std::ostream& out, int indent = 0) const override;
-};
\ No newline at end of file
+    void print(std::ostream& out) const;
+};
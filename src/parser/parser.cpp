@@ -1,31 +1,46 @@
 #include "parser.hpp"
 #include <spdlog/spdlog.h>
+#include <algorithm>
+#include <charconv>
 
 std::unique_ptr<Program> Parser::parse() {
     auto program = std::make_unique<Program>();
+    this->program = program.get();
 
     while (!this->isAtEnd()) {
+        const size_t statements = this->statementScratch.size();
         try {
             if (auto stmt = this->makeStatement()) {
-                program->statements.push_back(std::move(stmt));
+                this->statementScratch.push_back(stmt);
             }
         } catch (const std::exception& e) {
             spdlog::error("Parser error: {}", e.what());
+            // drop whatever the unfinished statement's blocks had collected
+            this->statementScratch.resize(statements);
+            this->expressionScratch.clear();
             this->skipToNextStatement();
         }
     }
 
+    program->statements = program->arena.copy(StatementList(this->statementScratch));
+    this->statementScratch.clear();
+    this->program = nullptr;
     return program;
 }
 
-const Token& Parser::peek(const size_t offset) const {
-    if (this->pos + offset >= this->tokens.size()) {
-        return this->tokens.back();
+const Token& Parser::peek(const int offset) {
+    const size_t index = offset < 0 && this->pos < static_cast<size_t>(-offset) ? 0 : this->pos + offset;
+
+    while (this->pulled <= index) {
+        // once the lexer is exhausted it keeps returning EndOfFile
+        const Token& token = this->window[this->pulled % lookahead].emplace(this->lexer.next());
+        this->program->lines.add(token.line, token.offset - token.column);
+        this->pulled++;
     }
-    return this->tokens[this->pos + offset];
+    return *this->window[index % lookahead];
 }
 
-const Token& Parser::current() const {
+const Token& Parser::current() {
     return this->peek(0);
 }
 
@@ -34,8 +49,8 @@ Token Parser::advance() {
     return this->peek(-1);
 }
 
-bool Parser::isAtEnd() const {
-    return this->pos >= this->tokens.size();
+bool Parser::isAtEnd() {
+    return this->current().type == TokenTyp::EndOfFile;
 }
 
 bool Parser::match(const TokenTyp type) {
@@ -55,12 +70,12 @@ Token Parser::consume(TokenTyp type, const std::string& message) {
     this->reporter.addError(message, this->getLocation(),
         "expected '" + tokenTypeToString(type) + "'");
 
-    return {type, "", this->current().line, this->current().column};
+    return {type, std::string_view(), this->current().offset, this->current().line, this->current().column};
 }
 
-SourceLocation Parser::getLocation() const {
+SourceLocation Parser::getLocation() {
     const auto& tok = this->current();
-    return SourceLocation(tok.line, tok.column, tok.value.length());
+    return SourceLocation(tok.line, tok.column, std::max<size_t>(tok.value.length(), 1));
 }
 
 void Parser::skipToNextStatement() {
@@ -77,7 +92,7 @@ void Parser::skipToNextStatement() {
     }
 }
 
-std::unique_ptr<Statement> Parser::makeStatement() {
+Statement* Parser::makeStatement() {
     if (this->match(TokenTyp::If)) return this->makeIf();
     if (this->match(TokenTyp::While)) return this->makeWhile();
     if (this->match(TokenTyp::For)) return this->makeFor();
@@ -92,8 +107,24 @@ std::unique_ptr<Statement> Parser::makeStatement() {
     return this->makeAssignment();
 }
 
-std::unique_ptr<Statement> Parser::makeAssignment() {
-    const auto& startToken = this->current();
+// Parses statements up to one of the terminators, which is left for the caller to consume.
+StatementList Parser::makeBlock(const std::initializer_list<TokenTyp> terminators) {
+    const size_t mark = this->statementScratch.size();
+
+    while (!this->isAtEnd() && std::ranges::find(terminators, this->current().type) == terminators.end()) {
+        // nested blocks push above mark and pop back down before this one continues
+        if (Statement* s = this->makeStatement()) {
+            this->statementScratch.push_back(s);
+        }
+    }
+
+    const StatementList block = this->program->arena.copy(StatementList(this->statementScratch).subspan(mark));
+    this->statementScratch.resize(mark);
+    return block;
+}
+
+Statement* Parser::makeAssignment() {
+    const Token startToken = this->current();
 
     if (startToken.type == TokenTyp::Then ||
         startToken.type == TokenTyp::ElseIf ||
@@ -105,7 +136,7 @@ std::unique_ptr<Statement> Parser::makeAssignment() {
         startToken.type == TokenTyp::To ||
         startToken.type == TokenTyp::Step) {
         this->reporter.addError(
-            "unexpected keyword '" + startToken.value + "'",
+            "unexpected keyword '" + std::string(startToken.value) + "'",
             this->getLocation(),
             "expected statement"
         );
@@ -117,57 +148,45 @@ std::unique_ptr<Statement> Parser::makeAssignment() {
 
     if (this->match(TokenTyp::Equal)) {
         auto value = this->makeExpression();
-        return std::make_unique<AssignmentStatement>(
-            std::move(expr), std::move(value),
-            startToken.line, startToken.column
-        );
+        return this->make<AssignmentStatement>(startToken, expr, value);
     }
 
-    return std::make_unique<ExpressionStatement>(
-        std::move(expr), startToken.line, startToken.column
-    );
+    return this->make<ExpressionStatement>(startToken, expr);
 }
 
-std::unique_ptr<Expression> Parser::makeAssignmentTarget() {
+Expression* Parser::makeAssignmentTarget() {
     auto expr = this->makePrimary();
 
     while (true) {
         if (this->match(TokenTyp::LeftBracket)) {
-            const auto& bracketToken = this->peek(-1);
+            const Token bracketToken = this->peek(-1);
             auto index = this->makeExpression();
             this->consume(TokenTyp::RightBracket, "expected ']'");
 
-            expr = std::make_unique<ArrayAccess>(
-                std::move(expr), std::move(index),
-                bracketToken.line, bracketToken.column
-            );
+            expr = this->make<ArrayAccess>(bracketToken, expr, index);
         }
         else if (this->match(TokenTyp::Dot)) {
-            const auto& dotToken = this->peek(-1);
+            const Token dotToken = this->peek(-1);
             Token propToken = this->consume(TokenTyp::Identifier, "expected property name");
 
-            expr = std::make_unique<PropertyAccess>(
-                std::move(expr), propToken.value,
-                dotToken.line, dotToken.column
-            );
+            expr = this->make<PropertyAccess>(dotToken, expr, this->program->symbols.intern(propToken.value));
         }
         else if (this->current().type == TokenTyp::LeftParen) {
-            const auto& parenToken = this->current();
+            const Token parenToken = this->current();
             this->advance();
-            std::vector<std::unique_ptr<Expression>> arguments;
+            const size_t mark = this->expressionScratch.size();
 
             if (this->current().type != TokenTyp::RightParen) {
                 do {
-                    arguments.push_back(this->makeExpression());
+                    this->expressionScratch.push_back(this->makeExpression());
                 } while (this->match(TokenTyp::Comma));
             }
 
             this->consume(TokenTyp::RightParen, "expected ')'");
+            const ExpressionList arguments = this->program->arena.copy(ExpressionList(this->expressionScratch).subspan(mark));
+            this->expressionScratch.resize(mark);
 
-            expr = std::make_unique<CallExpression>(
-                std::move(expr), std::move(arguments),
-                parenToken.line, parenToken.column
-            );
+            expr = this->make<CallExpression>(parenToken, expr, arguments);
         }
         else {
             break;
@@ -177,71 +196,50 @@ std::unique_ptr<Expression> Parser::makeAssignmentTarget() {
     return expr;
 }
 
-std::unique_ptr<Statement> Parser::makeIf() {
-    const auto& ifToken = this->peek(-1);
+Statement* Parser::makeIf() {
+    const Token ifToken = this->peek(-1);
     auto condition = this->makeExpression();
     this->consume(TokenTyp::Then, "expected 'Then' after if condition");
 
-    auto stmt = std::make_unique<IfStatement>(
-        std::move(condition), ifToken.line, ifToken.column
-    );
+    auto stmt = this->make<IfStatement>(ifToken, condition);
 
     // Then block
-    while (!this->isAtEnd() &&
-           this->current().type != TokenTyp::ElseIf &&
-           this->current().type != TokenTyp::Else &&
-           this->current().type != TokenTyp::EndIf) {
-        auto s = this->makeStatement();
-        if (s) stmt->thenBlock.push_back(std::move(s));
-    }
+    stmt->thenBlock = this->makeBlock({TokenTyp::ElseIf, TokenTyp::Else, TokenTyp::EndIf});
 
     // ElseIf blocks
+    std::vector<ElseIfBlock> elseIfBlocks;
     while (this->match(TokenTyp::ElseIf)) {
         auto cond = this->makeExpression();
         this->consume(TokenTyp::Then, "expected 'Then' after elseif condition");
 
-        std::vector<std::unique_ptr<Statement>> block;
-        while (!this->isAtEnd() &&
-               this->current().type != TokenTyp::ElseIf &&
-               this->current().type != TokenTyp::Else &&
-               this->current().type != TokenTyp::EndIf) {
-            auto s = this->makeStatement();
-            if (s) block.push_back(std::move(s));
-        }
-        stmt->elseIfBlocks.emplace_back(std::move(cond), std::move(block));
+        auto block = this->makeBlock({TokenTyp::ElseIf, TokenTyp::Else, TokenTyp::EndIf});
+        elseIfBlocks.push_back({cond, block});
     }
+    stmt->elseIfBlocks = this->program->arena.copy(std::span<const ElseIfBlock>(elseIfBlocks));
 
     // Else block
     if (this->match(TokenTyp::Else)) {
-        while (!this->isAtEnd() && this->current().type != TokenTyp::EndIf) {
-            auto s = this->makeStatement();
-            if (s) stmt->elseBlock.push_back(std::move(s));
-        }
+        stmt->elseBlock = this->makeBlock({TokenTyp::EndIf});
     }
 
     this->consume(TokenTyp::EndIf, "expected 'EndIf'");
     return stmt;
 }
 
-std::unique_ptr<Statement> Parser::makeWhile() {
-    const auto& whileToken = this->peek(-1);
+Statement* Parser::makeWhile() {
+    const Token whileToken = this->peek(-1);
     auto condition = this->makeExpression();
 
-    auto stmt = std::make_unique<WhileStatement>(
-        std::move(condition), whileToken.line, whileToken.column
-    );
+    auto stmt = this->make<WhileStatement>(whileToken, condition);
 
-    while (!this->isAtEnd() && this->current().type != TokenTyp::EndWhile) {
-        auto s = this->makeStatement();
-        if (s) stmt->body.push_back(std::move(s));
-    }
+    stmt->body = this->makeBlock({TokenTyp::EndWhile});
 
     this->consume(TokenTyp::EndWhile, "expected 'EndWhile'");
     return stmt;
 }
 
-std::unique_ptr<Statement> Parser::makeFor() {
-    const auto& forToken = this->peek(-1);
+Statement* Parser::makeFor() {
+    const Token forToken = this->peek(-1);
 
     const Token varToken = this->consume(TokenTyp::Identifier, "expected variable name");
     this->consume(TokenTyp::Equal, "expected '='");
@@ -249,95 +247,74 @@ std::unique_ptr<Statement> Parser::makeFor() {
     this->consume(TokenTyp::To, "expected 'To'");
     auto end = this->makeExpression();
 
-    std::unique_ptr<Expression> step = nullptr;
+    Expression* step = nullptr;
     if (this->match(TokenTyp::Step)) {
         step = this->makeExpression();
     }
 
-    auto stmt = std::make_unique<ForStatement>(
-        varToken.value, std::move(start), std::move(end), std::move(step),
-        forToken.line, forToken.column
-    );
+    auto stmt = this->make<ForStatement>(forToken, this->program->symbols.intern(varToken.value), start, end, step);
 
-    while (!this->isAtEnd() && this->current().type != TokenTyp::EndFor) {
-        auto s = this->makeStatement();
-        if (s) stmt->body.push_back(std::move(s));
-    }
+    stmt->body = this->makeBlock({TokenTyp::EndFor});
 
     this->consume(TokenTyp::EndFor, "expected 'EndFor'");
     return stmt;
 }
 
-std::unique_ptr<Statement> Parser::makeSub() {
-    const auto& subToken = this->peek(-1);
+Statement* Parser::makeSub() {
+    const Token subToken = this->peek(-1);
     const Token nameToken = this->consume(TokenTyp::Identifier, "expected subroutine name");
 
-    auto stmt = std::make_unique<SubroutineStatement>(
-        nameToken.value, subToken.line, subToken.column
-    );
+    auto stmt = this->make<SubroutineStatement>(subToken, this->program->symbols.intern(nameToken.value));
 
-    while (!this->isAtEnd() && this->current().type != TokenTyp::EndSub) {
-        auto s = this->makeStatement();
-        if (s) stmt->body.push_back(std::move(s));
-    }
+    stmt->body = this->makeBlock({TokenTyp::EndSub});
 
     this->consume(TokenTyp::EndSub, "expected 'EndSub'");
     return stmt;
 }
 
-std::unique_ptr<Statement> Parser::makeGoto() {
-    const auto& gotoToken = this->peek(-1);
+Statement* Parser::makeGoto() {
+    const Token gotoToken = this->peek(-1);
     const Token labelToken = this->consume(TokenTyp::Identifier, "expected label");
 
-    return std::make_unique<GotoStatement>(
-        labelToken.value, gotoToken.line, gotoToken.column
-    );
+    return this->make<GotoStatement>(gotoToken, this->program->symbols.intern(labelToken.value));
 }
 
-std::unique_ptr<Statement> Parser::makeLabel() {
+Statement* Parser::makeLabel() {
     const Token labelToken = this->advance();
     this->consume(TokenTyp::Colon, "expected ':'");
 
-    return std::make_unique<LabelStatement>(
-        labelToken.value, labelToken.line, labelToken.column
-    );
+    return this->make<LabelStatement>(labelToken, this->program->symbols.intern(labelToken.value));
 }
 
-std::unique_ptr<Expression> Parser::makeExpression() {
+Expression* Parser::makeExpression() {
     return this->makeOr();
 }
 
-std::unique_ptr<Expression> Parser::makeOr() {
+Expression* Parser::makeOr() {
     auto expr = this->makeAnd();
 
     while (this->match(TokenTyp::Or)) {
-        const auto& opToken = this->peek(-1);
+        const Token opToken = this->peek(-1);
         auto right = this->makeAnd();
-        expr = std::make_unique<BinaryExpression>(
-            BinaryOp::Or, std::move(expr), std::move(right),
-            opToken.line, opToken.column
-        );
+        expr = this->make<BinaryExpression>(opToken, BinaryOp::Or, expr, right);
     }
 
     return expr;
 }
 
-std::unique_ptr<Expression> Parser::makeAnd() {
+Expression* Parser::makeAnd() {
     auto expr = this->makeComparison();
 
     while (this->match(TokenTyp::And)) {
-        const auto& opToken = this->peek(-1);
+        const Token opToken = this->peek(-1);
         auto right = this->makeComparison();
-        expr = std::make_unique<BinaryExpression>(
-            BinaryOp::And, std::move(expr), std::move(right),
-            opToken.line, opToken.column
-        );
+        expr = this->make<BinaryExpression>(opToken, BinaryOp::And, expr, right);
     }
 
     return expr;
 }
 
-std::unique_ptr<Expression> Parser::makeComparison() {
+Expression* Parser::makeComparison() {
     auto expr = this->makeAdditive();
 
     while (true) {
@@ -366,18 +343,15 @@ std::unique_ptr<Expression> Parser::makeComparison() {
 
         if (!matched) break;
 
-        const auto& opToken = this->peek(-1);
+        const Token opToken = this->peek(-1);
         auto right = this->makeAdditive();
-        expr = std::make_unique<BinaryExpression>(
-            op, std::move(expr), std::move(right),
-            opToken.line, opToken.column
-        );
+        expr = this->make<BinaryExpression>(opToken, op, expr, right);
     }
 
     return expr;
 }
 
-std::unique_ptr<Expression> Parser::makeAdditive() {
+Expression* Parser::makeAdditive() {
     auto expr = this->makeMultiplicative();
 
     while (true) {
@@ -394,18 +368,15 @@ std::unique_ptr<Expression> Parser::makeAdditive() {
 
         if (!matched) break;
 
-        const auto& opToken = this->peek(-1);
+        const Token opToken = this->peek(-1);
         auto right = this->makeMultiplicative();
-        expr = std::make_unique<BinaryExpression>(
-            op, std::move(expr), std::move(right),
-            opToken.line, opToken.column
-        );
+        expr = this->make<BinaryExpression>(opToken, op, expr, right);
     }
 
     return expr;
 }
 
-std::unique_ptr<Expression> Parser::makeMultiplicative() {
+Expression* Parser::makeMultiplicative() {
     auto expr = this->makeUnary();
 
     while (true) {
@@ -422,69 +393,56 @@ std::unique_ptr<Expression> Parser::makeMultiplicative() {
 
         if (!matched) break;
 
-        const auto& opToken = this->peek(-1);
+        const Token opToken = this->peek(-1);
         auto right = this->makeUnary();
-        expr = std::make_unique<BinaryExpression>(
-            op, std::move(expr), std::move(right),
-            opToken.line, opToken.column
-        );
+        expr = this->make<BinaryExpression>(opToken, op, expr, right);
     }
 
     return expr;
 }
 
-std::unique_ptr<Expression> Parser::makeUnary() {
+Expression* Parser::makeUnary() {
     if (this->match(TokenTyp::Minus)) {
-        const auto& opToken = this->peek(-1);
+        const Token opToken = this->peek(-1);
         auto operand = this->makeUnary();
-        return std::make_unique<UnaryExpression>(
-            std::move(operand),
-            opToken.line, opToken.column
-        );
+        return this->make<UnaryExpression>(opToken, operand);
     }
 
     return this->makePostfix();
 }
 
-std::unique_ptr<Expression> Parser::makePostfix() {
+Expression* Parser::makePostfix() {
     auto expr = this->makePrimary();
 
     while (true) {
         if (this->match(TokenTyp::LeftBracket)) {
-            const auto& bracketToken = this->peek(-1);
+            const Token bracketToken = this->peek(-1);
             auto index = this->makeExpression();
             this->consume(TokenTyp::RightBracket, "expected ']'");
 
-            expr = std::make_unique<ArrayAccess>(
-                std::move(expr), std::move(index),
-                bracketToken.line, bracketToken.column
-            );
+            expr = this->make<ArrayAccess>(bracketToken, expr, index);
         }
         else if (this->match(TokenTyp::Dot)) {
-            const auto& dotToken = this->peek(-1);
+            const Token dotToken = this->peek(-1);
             Token propToken = this->consume(TokenTyp::Identifier, "expected property name");
 
-            expr = std::make_unique<PropertyAccess>(
-                std::move(expr), propToken.value,
-                dotToken.line, dotToken.column
-            );
+            expr = this->make<PropertyAccess>(dotToken, expr, this->program->symbols.intern(propToken.value));
         }
         else if (this->match(TokenTyp::LeftParen)) {
-            const auto& parenToken = this->peek(-1);
-            std::vector<std::unique_ptr<Expression>> arguments;
+            const Token parenToken = this->peek(-1);
+            const size_t mark = this->expressionScratch.size();
 
             if (this->current().type != TokenTyp::RightParen) {
                 do {
-                    arguments.push_back(this->makeExpression());
+                    this->expressionScratch.push_back(this->makeExpression());
                 } while (this->match(TokenTyp::Comma));
             }
 
             this->consume(TokenTyp::RightParen, "expected ')'");
+            const ExpressionList arguments = this->program->arena.copy(ExpressionList(this->expressionScratch).subspan(mark));
+            this->expressionScratch.resize(mark);
 
-            expr = std::make_unique<CallExpression>(
-                std::move(expr), std::move(arguments),
-                parenToken.line, parenToken.column
-            );
+            expr = this->make<CallExpression>(parenToken, expr, arguments);
         }
         else {
             break;
@@ -494,21 +452,22 @@ std::unique_ptr<Expression> Parser::makePostfix() {
     return expr;
 }
 
-std::unique_ptr<Expression> Parser::makePrimary() {
+Expression* Parser::makePrimary() {
     if (this->match(TokenTyp::NumberLiteral)) {
-        const auto& token = this->peek(-1);
-        double value = std::stod(token.value);
-        return std::make_unique<NumberLiteral>(value, token.line, token.column);
+        const Token token = this->peek(-1);
+        double value = 0;
+        std::from_chars(token.value.data(), token.value.data() + token.value.size(), value);
+        return this->make<NumberLiteral>(token, value);
     }
 
     if (this->match(TokenTyp::StringLiteral)) {
-        const auto& token = this->peek(-1);
-        return std::make_unique<StringLiteral>(token.value, token.line, token.column);
+        const Token token = this->peek(-1);
+        return this->make<StringLiteral>(token, this->program->arena.copy(token.value));
     }
 
     if (this->match(TokenTyp::Identifier)) {
-        const auto& token = this->peek(-1);
-        return std::make_unique<Identifier>(token.value, token.line, token.column);
+        const Token token = this->peek(-1);
+        return this->make<Identifier>(token, this->program->symbols.intern(token.value));
     }
 
     if (this->match(TokenTyp::LeftParen)) {
@@ -517,9 +476,9 @@ std::unique_ptr<Expression> Parser::makePrimary() {
         return expr;
     }
 
-    const auto& tok = this->current();
+    const Token tok = this->current();
     this->reporter.addError(
-        "unexpected token: '" + tok.value + "'",
+        tok.type == TokenTyp::EndOfFile ? "unexpected end of file" : "unexpected token: '" + std::string(tok.value) + "'",
         this->getLocation(),
         "expected expression"
     );
@@ -528,5 +487,5 @@ std::unique_ptr<Expression> Parser::makePrimary() {
         this->advance();
     }
 
-    return std::make_unique<NumberLiteral>(0, tok.line, tok.column);
+    return this->make<NumberLiteral>(tok, 0);
 }
\ No newline at end of file
@@ -1,49 +1,69 @@
 #pragma once
+#include <array>
+#include <initializer_list>
 #include <memory>
+#include <optional>
 #include <vector>
-#include "../lexer/token.hpp"
+#include "../lexer/lexer.hpp"
 #include "ast.hpp"
 #include "../diagnostic.hpp"
 
+// Pulls tokens from the lexer on demand. The parser looks at most one token back and one ahead,
+// so a small ring buffer replaces the materialized token vector.
 class Parser {
 public:
-    Parser(const std::vector<Token>& toks, DiagnosticReporter& diag)
-        : tokens(toks), reporter(diag), pos(0) {}
+    Parser(Lexer& lexer, DiagnosticReporter& diag)
+        : lexer(lexer), reporter(diag), pos(0), pulled(0), program(nullptr) {}
 
     std::unique_ptr<Program> parse();
 
 private:
-    const std::vector<Token>& tokens;
+    static constexpr size_t lookahead = 4; // previous, current and next token, rounded up to a power of two
+
+    Lexer& lexer;
     DiagnosticReporter& reporter;
     size_t pos;
+    size_t pulled;
+    std::array<std::optional<Token>, lookahead> window;
+
+    // the program being built; blocks collect their children here before copying them into its arena
+    Program* program;
+    std::vector<Statement*> statementScratch;
+    std::vector<Expression*> expressionScratch;
 
-    const Token& peek(size_t offset = 0) const;
-    const Token& current() const;
+    const Token& peek(int offset = 0);
+    const Token& current();
     Token advance();
-    bool isAtEnd() const;
+    bool isAtEnd();
     bool match(TokenTyp type);
     Token consume(TokenTyp type, const std::string& message);
 
-    std::unique_ptr<Statement> makeStatement();
-    std::unique_ptr<Statement> makeAssignment();
-    std::unique_ptr<Statement> makeIf();
-    std::unique_ptr<Statement> makeWhile();
-    std::unique_ptr<Statement> makeFor();
-    std::unique_ptr<Statement> makeSub();
-    std::unique_ptr<Statement> makeGoto();
-    std::unique_ptr<Statement> makeLabel();
-
-    std::unique_ptr<Expression> makeExpression();
-    std::unique_ptr<Expression> makeAssignmentTarget();
-    std::unique_ptr<Expression> makeOr();
-    std::unique_ptr<Expression> makeAnd();
-    std::unique_ptr<Expression> makeComparison();
-    std::unique_ptr<Expression> makeAdditive();
-    std::unique_ptr<Expression> makeMultiplicative();
-    std::unique_ptr<Expression> makeUnary();
-    std::unique_ptr<Expression> makePostfix();
-    std::unique_ptr<Expression> makePrimary();
+    Statement* makeStatement();
+    StatementList makeBlock(std::initializer_list<TokenTyp> terminators);
+    Statement* makeAssignment();
+    Statement* makeIf();
+    Statement* makeWhile();
+    Statement* makeFor();
+    Statement* makeSub();
+    Statement* makeGoto();
+    Statement* makeLabel();
+
+    Expression* makeExpression();
+    Expression* makeAssignmentTarget();
+    Expression* makeOr();
+    Expression* makeAnd();
+    Expression* makeComparison();
+    Expression* makeAdditive();
+    Expression* makeMultiplicative();
+    Expression* makeUnary();
+    Expression* makePostfix();
+    Expression* makePrimary();
+
+    template <typename T, typename... Args>
+    T* make(const Token& token, Args&&... args) {
+        return this->program->arena.make<T>(std::forward<Args>(args)..., static_cast<uint32_t>(token.offset));
+    }
 
     void skipToNextStatement();
-    SourceLocation getLocation() const;
+    SourceLocation getLocation();
 };
\ No newline at end of file
@@ -0,0 +1,64 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "arena.hpp"
+
+using SymbolId = uint32_t;
+using FoldedId = uint32_t;
+
+// Interns the names of variables, labels, subroutines and properties, so each spelling is stored
+// once in the program's arena and AST nodes refer to it by a dense id. Every spelling is also
+// mapped to the dense id of its lower-cased form, which is how the case-insensitive names
+// (variables and subroutines) are keyed in the passes' side tables.
+class SymbolTable {
+public:
+    explicit SymbolTable(Arena& arena) : arena(arena) {}
+
+    SymbolId intern(const std::string_view name) {
+        if (const auto it = this->ids.find(name); it != this->ids.end()) {
+            return it->second;
+        }
+
+        const std::string_view stored = this->arena.copy(name);
+        const auto id = static_cast<SymbolId>(this->names.size());
+        this->names.push_back(stored);
+        this->ids.emplace(stored, id);
+        this->foldedIds.push_back(this->internFolded(name));
+        return id;
+    }
+
+    [[nodiscard]] std::string_view name(const SymbolId id) const { return this->names[id]; }
+    [[nodiscard]] size_t size() const { return this->names.size(); }
+
+    [[nodiscard]] FoldedId folded(const SymbolId id) const { return this->foldedIds[id]; }
+    [[nodiscard]] std::string_view foldedName(const FoldedId id) const { return this->foldedNames[id]; }
+    [[nodiscard]] size_t foldedSize() const { return this->foldedNames.size(); }
+
+private:
+    Arena& arena;
+    std::vector<std::string_view> names;
+    std::unordered_map<std::string_view, SymbolId> ids;
+    std::vector<FoldedId> foldedIds; // by SymbolId
+    std::vector<std::string_view> foldedNames;
+    std::unordered_map<std::string_view, FoldedId> foldedIndex;
+
+    FoldedId internFolded(const std::string_view name) {
+        std::string lower(name);
+        for (char& c : lower) {
+            if (c >= 'A' && c <= 'Z') c = static_cast<char>(c - 'A' + 'a');
+        }
+
+        if (const auto it = this->foldedIndex.find(lower); it != this->foldedIndex.end()) {
+            return it->second;
+        }
+
+        const std::string_view stored = lower == name ? this->names.back() : this->arena.copy(lower);
+        const auto id = static_cast<FoldedId>(this->foldedNames.size());
+        this->foldedNames.push_back(stored);
+        this->foldedIndex.emplace(stored, id);
+        return id;
+    }
+};
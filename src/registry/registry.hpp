@@ -1,9 +1,11 @@
 #pragma once
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <initializer_list>
 #include <string>
-#include <unordered_map>
+#include <string_view>
 #include <vector>
-#include <optional>
-#include <algorithm>
 
 enum class ParamType {
     Number,
@@ -19,124 +21,224 @@ enum class ReturnType {
     Array
 };
 
+// Parameter types of a standard library function, stored inline so the tables below are constexpr.
+struct ParamList {
+    std::array<ParamType, 3> types{};
+    uint8_t count = 0;
+
+    constexpr ParamList() = default;
+    constexpr ParamList(const std::initializer_list<ParamType> list) {
+        for (const ParamType type : list) types[count++] = type;
+    }
+
+    [[nodiscard]] constexpr size_t size() const { return count; }
+    [[nodiscard]] constexpr const ParamType* begin() const { return types.data(); }
+    [[nodiscard]] constexpr const ParamType* end() const { return types.data() + count; }
+    constexpr ParamType operator[](const size_t i) const { return types[i]; }
+};
+
 struct FunctionInfo {
-    std::vector<ParamType> params;
+    ParamList params;
     ReturnType returnType;
 };
 
-using FunctionRegistry  = std::unordered_map<std::string, std::unordered_map<std::string, FunctionInfo>>;
 struct PropertyInfo {
     ReturnType returnType;
     bool readOnly;
 };
 
-using PropertyRegistry  = std::unordered_map<std::string, std::unordered_map<std::string, PropertyInfo>>;
-
-struct Registry {
-    FunctionRegistry functions = {
-        {"textwindow", {
-            {"writeline", {{ParamType::String}, ReturnType::Void}},
-            {"write", {{ParamType::String}, ReturnType::Void}},
-            {"read", {{}, ReturnType::String}},
-            {"pause",  {{}, ReturnType::Void}},
-        }},
-        {"math", {
-            {"abs", {{ParamType::Number}, ReturnType::Number}}
-        }},
-        {"program", {
-            {"delay",{{ParamType::Number}, ReturnType::Void}},
-            {"getargument",{{ParamType::Number}, ReturnType::Number}},
-            {"end",{{}, ReturnType::Void}},
-        }},
-        {"array", {
-            {"containsindex", {{ParamType::Array, ParamType::Any}, ReturnType::String}},
-            {"containsvalue", {{ParamType::Array, ParamType::Any}, ReturnType::String}},
-            {"getitemcount", {{ParamType::Array}, ReturnType::Number}},
-            {"getallindices", {{ParamType::Array}, ReturnType::Array}},
-            {"isarray", {{ParamType::Array}, ReturnType::String}},
-            {"setvalue", {{ParamType::String, ParamType::Any, ParamType::Any}, ReturnType::Void}},
-            {"getvalue", {{ParamType::String, ParamType::Any}, ReturnType::String}},
-            {"removevalue", {{ParamType::String, ParamType::Any}, ReturnType::Void}}
-        }},
-    };
-
-    PropertyRegistry properties = {
-        {"textwindow", {
-                {"title", {ReturnType::String, false}}
-        }},
-        {"clock", {
-            {"time", {ReturnType::String, true}},
-            {"date", {ReturnType::String, true}},
-            {"year", {ReturnType::Number, true}},
-            {"month", {ReturnType::Number, true}},
-            {"day", {ReturnType::Number, true}},
-            {"weekday", {ReturnType::String, true}},
-            {"hour", {ReturnType::Number, true}},
-            {"minute", {ReturnType::Number, true}},
-            {"second", {ReturnType::Number, true}},
-            {"millisecond", {ReturnType::Number, true}},
-            {"elapsedmilliseconds", {ReturnType::Number, true}}
-        }},
-        {"program", {
-            {"argumentcount", {ReturnType::Number, true}},
-            {"directory", {ReturnType::String, true}}
-        }},
-    };
-
-    static std::string toLower(const std::string& s) {
-        std::string out;
-        out.resize(s.size());
-        std::ranges::transform(s, out.begin(), [](const unsigned char c){ return static_cast<char>(std::tolower(c)); });
-        return out;
-    }
-
-    bool hasObject(const std::string& obj) const {
-        const auto object = toLower(obj);
-
-        return functions.contains(object) || properties.contains(object);
-    }
-
-    bool hasFunction(const std::string& obj, const std::string& function) const {
-        const auto object = toLower(obj);
-        const auto func = toLower(function);
-
-        const auto it = functions.find(object);
-        return it != functions.end() && it->second.contains(func);
-    }
-
-    bool hasProperty(const std::string& obj, const std::string& property) const {
-        const auto object = toLower(obj);
-        const auto prop = toLower(property);
-
-        const auto it = properties.find(object);
-        return it != properties.end() && it->second.contains(prop);
-    }
-
-    std::optional<FunctionInfo> getFunction(const std::string& obj, const std::string& function) const {
-        const auto object = toLower(obj);
-        const auto func = toLower(function);
-
-        const auto it = functions.find(object);
-        if (it == functions.end()) return std::nullopt;
-        const auto jt = it->second.find(func);
-        if (jt == it->second.end()) return std::nullopt;
-        return jt->second;
-    }
-
-    std::optional<PropertyInfo> getProperty(const std::string& obj, const std::string& property) const {
-        const auto object = toLower(obj);
-        const auto prop = toLower(property);
-
-        const auto it = properties.find(object);
-        if (it == properties.end()) return std::nullopt;
-        const auto jt = it->second.find(prop);
-        if (jt == it->second.end()) return std::nullopt;
-        return jt->second;
-    }
-
-    bool validateFunctionCall(const std::string& object, const std::string& func,
-                              const std::vector<ParamType>& args) const {
-        const auto info = getFunction(object, func);
+namespace registry_detail {
+
+constexpr char fold(const char c) {
+    return c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+constexpr bool equalFolded(const std::string_view a, const std::string_view b) {
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); i++) {
+        if (fold(a[i]) != fold(b[i])) return false;
+    }
+    return true;
+}
+
+// FNV-1a over the case-folded key "object.member", then a final mix so the low bits used for
+// the slot index depend on every byte.
+constexpr uint32_t hash(const std::string_view object, const std::string_view member, const uint32_t seed) {
+    uint32_t h = 2166136261u ^ seed;
+    for (const char c : object) h = (h ^ static_cast<uint8_t>(fold(c))) * 16777619u;
+    h = (h ^ static_cast<uint8_t>('.')) * 16777619u;
+    for (const char c : member) h = (h ^ static_cast<uint8_t>(fold(c))) * 16777619u;
+    h ^= h >> 15;
+    h *= 0x2c1b3c6du;
+    h ^= h >> 12;
+    return h;
+}
+
+// Runtime symbol for a member, e.g. "clock_time_get": the lower-cased object and member names
+// joined by '_', plus an optional suffix.
+struct Symbol {
+    std::array<char, 48> text{};
+    uint8_t length = 0;
+
+    constexpr Symbol(const std::string_view object, const std::string_view member, const std::string_view suffix = "") {
+        for (const char c : object) text[length++] = fold(c);
+        text[length++] = '_';
+        for (const char c : member) text[length++] = fold(c);
+        for (const char c : suffix) text[length++] = c;
+    }
+
+    [[nodiscard]] constexpr std::string_view view() const { return {text.data(), length}; }
+};
+
+// Collision-free lookup table: the constructor searches for a hash seed that gives every
+// key its own slot, so a lookup is one hash, one slot load and one case-insensitive compare.
+template <typename Entry, size_t N>
+class PerfectHashTable {
+public:
+    static constexpr size_t slotCount = std::bit_ceil(N * 4);
+
+    std::array<Entry, N> entries;
+
+    constexpr explicit PerfectHashTable(const std::array<Entry, N>& items) : entries(items) {
+        while (!this->tryAssign()) {
+            this->seed++;
+        }
+    }
+
+    [[nodiscard]] constexpr const Entry* find(const std::string_view object, const std::string_view member = "") const {
+        const uint8_t slot = this->slots[hash(object, member, this->seed) & (slotCount - 1)];
+        if (slot == 0) return nullptr;
+        const Entry& entry = this->entries[slot - 1];
+        return equalFolded(entry.object, object) && equalFolded(entry.member, member) ? &entry : nullptr;
+    }
+
+    [[nodiscard]] constexpr size_t indexOf(const Entry& entry) const { return &entry - this->entries.data(); }
+
+private:
+    static_assert(N < 255, "slots store entry indices in a byte");
+
+    std::array<uint8_t, slotCount> slots{};
+    uint32_t seed = 0;
+
+    constexpr bool tryAssign() {
+        this->slots = {};
+        for (size_t i = 0; i < N; i++) {
+            uint8_t& slot = this->slots[hash(this->entries[i].object, this->entries[i].member, this->seed) & (slotCount - 1)];
+            if (slot != 0) return false;
+            slot = static_cast<uint8_t>(i + 1);
+        }
+        return true;
+    }
+};
+
+struct ObjectEntry {
+    std::string_view object;
+    std::string_view member = "";
+};
+
+struct FunctionEntry {
+    std::string_view object;
+    std::string_view member;
+    FunctionInfo info;
+    Symbol symbol{object, member};
+};
+
+struct PropertyEntry {
+    std::string_view object;
+    std::string_view member;
+    PropertyInfo info;
+    Symbol getter{object, member, "_get"};
+    Symbol setter{object, member, "_set"};
+};
+
+}
+
+// The standard library as seen by the compiler. Keys are matched case-insensitively, and the
+// symbols of the runtime functions implementing each member are derived from the same table.
+class Registry {
+public:
+    using FunctionEntry = registry_detail::FunctionEntry;
+    using PropertyEntry = registry_detail::PropertyEntry;
+
+    static constexpr registry_detail::PerfectHashTable functions{std::to_array<FunctionEntry>({
+        {"textwindow", "writeline", {{ParamType::String}, ReturnType::Void}},
+        {"textwindow", "write", {{ParamType::String}, ReturnType::Void}},
+        {"textwindow", "read", {{}, ReturnType::String}},
+        {"textwindow", "pause", {{}, ReturnType::Void}},
+
+        {"math", "abs", {{ParamType::Number}, ReturnType::Number}},
+
+        {"program", "delay", {{ParamType::Number}, ReturnType::Void}},
+        {"program", "getargument", {{ParamType::Number}, ReturnType::Number}},
+        {"program", "end", {{}, ReturnType::Void}},
+
+        {"array", "containsindex", {{ParamType::Array, ParamType::Any}, ReturnType::String}},
+        {"array", "containsvalue", {{ParamType::Array, ParamType::Any}, ReturnType::String}},
+        {"array", "getitemcount", {{ParamType::Array}, ReturnType::Number}},
+        {"array", "getallindices", {{ParamType::Array}, ReturnType::Array}},
+        {"array", "isarray", {{ParamType::Array}, ReturnType::String}},
+        {"array", "setvalue", {{ParamType::String, ParamType::Any, ParamType::Any}, ReturnType::Void}},
+        {"array", "getvalue", {{ParamType::String, ParamType::Any}, ReturnType::String}},
+        {"array", "removevalue", {{ParamType::String, ParamType::Any}, ReturnType::Void}},
+    })};
+
+    static constexpr registry_detail::PerfectHashTable properties{std::to_array<PropertyEntry>({
+        {"textwindow", "title", {ReturnType::String, false}},
+
+        {"clock", "time", {ReturnType::String, true}},
+        {"clock", "date", {ReturnType::String, true}},
+        {"clock", "year", {ReturnType::Number, true}},
+        {"clock", "month", {ReturnType::Number, true}},
+        {"clock", "day", {ReturnType::Number, true}},
+        {"clock", "weekday", {ReturnType::String, true}},
+        {"clock", "hour", {ReturnType::Number, true}},
+        {"clock", "minute", {ReturnType::Number, true}},
+        {"clock", "second", {ReturnType::Number, true}},
+        {"clock", "millisecond", {ReturnType::Number, true}},
+        {"clock", "elapsedmilliseconds", {ReturnType::Number, true}},
+        {"clock", "elapsednanoseconds", {ReturnType::Number, true}},
+
+        {"program", "argumentcount", {ReturnType::Number, true}},
+        {"program", "directory", {ReturnType::String, true}},
+    })};
+
+    static constexpr registry_detail::PerfectHashTable objects{std::to_array<registry_detail::ObjectEntry>({
+        {"textwindow"}, {"math"}, {"program"}, {"array"}, {"clock"},
+    })};
+
+    static constexpr bool hasObject(const std::string_view obj) {
+        return objects.find(obj) != nullptr;
+    }
+
+    static constexpr bool hasFunction(const std::string_view obj, const std::string_view function) {
+        return functions.find(obj, function) != nullptr;
+    }
+
+    static constexpr bool hasProperty(const std::string_view obj, const std::string_view property) {
+        return properties.find(obj, property) != nullptr;
+    }
+
+    static constexpr const FunctionEntry* findFunction(const std::string_view obj, const std::string_view function) {
+        return functions.find(obj, function);
+    }
+
+    static constexpr const PropertyEntry* findProperty(const std::string_view obj, const std::string_view property) {
+        return properties.find(obj, property);
+    }
+
+    static constexpr const FunctionInfo* getFunction(const std::string_view obj, const std::string_view function) {
+        const auto* entry = functions.find(obj, function);
+        return entry ? &entry->info : nullptr;
+    }
+
+    static constexpr const PropertyInfo* getProperty(const std::string_view obj, const std::string_view property) {
+        const auto* entry = properties.find(obj, property);
+        return entry ? &entry->info : nullptr;
+    }
+
+    static bool validateFunctionCall(const std::string_view object, const std::string_view func,
+                                     const std::vector<ParamType>& args) {
+        const auto* info = getFunction(object, func);
         if (!info) return false;
 
         const auto& expected = info->params;
@@ -170,3 +272,9 @@ struct Registry {
         return "Unknown";
     }
 };
+
+inline constexpr Registry registry;
+
+static_assert(Registry::hasFunction("TextWindow", "WriteLine"));
+static_assert(Registry::findProperty("Clock", "Time")->getter.view() == "clock_time_get");
+static_assert(!Registry::hasProperty("Clock", "WriteLine"));
@@ -2,14 +2,20 @@
 #include <ranges>
 #include <algorithm>
 
-#define CAST(Type, var, expr) auto var = dynamic_cast<Type*>(expr)
+#define CAST(Type, var, expr) auto var = nodeCast<Type>(expr)
 
 void SemanticAnalyzer::analyze(const Program& program) {
+    this->program = &program;
+    variables.assign(program.symbols.foldedSize(), false);
+    subroutines.assign(program.symbols.foldedSize(), false);
+    labels.assign(program.symbols.size(), false);
+    gotoTargets.assign(program.symbols.size(), false);
+
     for (const auto& stmt : program.statements) {
-        if (CAST(LabelStatement, labelStmt, stmt.get())) {
-            defineLabel(labelStmt->name, labelStmt->line, labelStmt->column);
-        } else if (CAST(SubroutineStatement, subStmt, stmt.get())) {
-            defineSubroutine(subStmt->name, subStmt->line, subStmt->column);
+        if (CAST(LabelStatement, labelStmt, stmt)) {
+            defineLabel(labelStmt->name, *labelStmt);
+        } else if (CAST(SubroutineStatement, subStmt, stmt)) {
+            defineSubroutine(subStmt->name, *subStmt);
         }
     }
 
@@ -21,73 +27,79 @@ void SemanticAnalyzer::analyze(const Program& program) {
 }
 
 void SemanticAnalyzer::analyzeStatement(Statement& stmt) {
-    if (CAST(AssignmentStatement, assignStmt, &stmt)) {
-        analyzeAssignment(*assignStmt);
-    } else if (CAST(ExpressionStatement, exprStmt, &stmt)) {
-        analyzeExpression(*exprStmt->expression);
-    } else if (CAST(IfStatement, ifStmt, &stmt)) {
-        analyzeExpression(*ifStmt->condition);
-        for (const auto& s : ifStmt->thenBlock) {
-            analyzeStatement(*s);
-        }
-        for (const auto& [cond, block] : ifStmt->elseIfBlocks) {
-            analyzeExpression(*cond);
-            for (const auto& s : block) {
+    visit(stmt, Overloaded{
+        [&](AssignmentStatement& assignStmt) {
+            analyzeAssignment(assignStmt);
+        },
+        [&](ExpressionStatement& exprStmt) {
+            analyzeExpression(*exprStmt.expression);
+        },
+        [&](IfStatement& ifStmt) {
+            analyzeExpression(*ifStmt.condition);
+            for (const auto& s : ifStmt.thenBlock) {
                 analyzeStatement(*s);
             }
-        }
-        for (const auto& s : ifStmt->elseBlock) {
-            analyzeStatement(*s);
-        }
-    } else if (CAST(WhileStatement, whileStmt, &stmt)) {
-        analyzeExpression(*whileStmt->condition);
-        for (const auto& s : whileStmt->body) {
-            analyzeStatement(*s);
-        }
-    } else if (CAST(ForStatement, forStmt, &stmt)) {
-        defineVariable(forStmt->variable);
-        analyzeExpression(*forStmt->start);
-        analyzeExpression(*forStmt->end);
-        if (forStmt->step) {
-            analyzeExpression(*forStmt->step);
-        }
-        for (const auto& s : forStmt->body) {
-            analyzeStatement(*s);
-        }
-    } else if (CAST(GotoStatement, gotoStmt, &stmt)) {
-        checkGotoTarget(gotoStmt->label, gotoStmt->line, gotoStmt->column);
-    } else if (CAST(SubroutineStatement, subStmt, &stmt)) {
-        bool wasInSubroutine = inSubroutine;
-        inSubroutine = true;
-        for (const auto& s : subStmt->body) {
-            analyzeStatement(*s);
-        }
-        inSubroutine = wasInSubroutine;
-    }
+            for (const auto& [cond, block] : ifStmt.elseIfBlocks) {
+                analyzeExpression(*cond);
+                for (const auto& s : block) {
+                    analyzeStatement(*s);
+                }
+            }
+            for (const auto& s : ifStmt.elseBlock) {
+                analyzeStatement(*s);
+            }
+        },
+        [&](WhileStatement& whileStmt) {
+            analyzeExpression(*whileStmt.condition);
+            for (const auto& s : whileStmt.body) {
+                analyzeStatement(*s);
+            }
+        },
+        [&](ForStatement& forStmt) {
+            defineVariable(forStmt.variable);
+            analyzeExpression(*forStmt.start);
+            analyzeExpression(*forStmt.end);
+            if (forStmt.step) {
+                analyzeExpression(*forStmt.step);
+            }
+            for (const auto& s : forStmt.body) {
+                analyzeStatement(*s);
+            }
+        },
+        [&](GotoStatement& gotoStmt) {
+            checkGotoTarget(gotoStmt.label, gotoStmt);
+        },
+        [&](SubroutineStatement& subStmt) {
+            bool wasInSubroutine = inSubroutine;
+            inSubroutine = true;
+            for (const auto& s : subStmt.body) {
+                analyzeStatement(*s);
+            }
+            inSubroutine = wasInSubroutine;
+        },
+        [](LabelStatement&) {},
+    });
 }
 
 void SemanticAnalyzer::analyzeAssignment(const AssignmentStatement& stmt) {
-    if (CAST(PropertyAccess, propAccess, stmt.target.get())) {
-        if (CAST(Identifier, objIdent, propAccess->object.get())) {
-            if (CAST(Identifier, handlerIdent, stmt.value.get())) {
-                const std::string& objectName = objIdent->name;
-                const std::string& handlerName = handlerIdent->name;
+    if (CAST(PropertyAccess, propAccess, stmt.target)) {
+        if (CAST(Identifier, objIdent, propAccess->object)) {
+            if (CAST(Identifier, handlerIdent, stmt.value)) {
+                const std::string objectName = program->name(objIdent->name);
+                const std::string handlerName = program->name(handlerIdent->name);
 
                 if (!registry.hasObject(objectName)) {
                     reporter.addError(
                         "unknown object '" + objectName + "'",
-                        SourceLocation(stmt.line, stmt.column, objectName.length()),
+                        program->location(stmt, objectName.length()),
                         "this object is not defined in the standard library"
                     );
                 }
 
-                std::string handlerNameLower = handlerName;
-                std::ranges::transform(handlerNameLower, handlerNameLower.begin(), ::tolower);
-                
-                if (!subroutines.contains(handlerNameLower)) {
+                if (!subroutines[program->symbols.folded(handlerIdent->name)]) {
                     reporter.addWarning(
                         "event handler '" + handlerName + "' is not defined",
-                        SourceLocation(handlerIdent->line, handlerIdent->column, handlerName.length()),
+                        program->location(*handlerIdent, handlerName.length()),
                         "make sure to define this subroutine before using it as an event handler"
                     );
                 }
@@ -102,42 +114,56 @@ void SemanticAnalyzer::analyzeAssignment(const AssignmentStatement& stmt) {
 }
 
 void SemanticAnalyzer::analyzeAssignmentTarget(Expression& expr) {
-    if (CAST(Identifier, ident, &expr)) {
-        defineVariable(ident->name);
-    } else if (CAST(ArrayAccess, arrAccess, &expr)) {
-        analyzeArrayAccess(*arrAccess, true);
-    } else if (CAST(PropertyAccess, propAccess, &expr)) {
-        analyzePropertyAccess(*propAccess, true);
-    } else {
-        analyzeExpression(expr);
+    switch (expr.kind) {
+        case NodeKind::Identifier:
+            defineVariable(static_cast<Identifier&>(expr).name);
+            break;
+        case NodeKind::ArrayAccess:
+            analyzeArrayAccess(static_cast<ArrayAccess&>(expr), true);
+            break;
+        case NodeKind::PropertyAccess:
+            analyzePropertyAccess(static_cast<PropertyAccess&>(expr), true);
+            break;
+        default:
+            analyzeExpression(expr);
+            break;
     }
 }
 
 void SemanticAnalyzer::analyzeExpression(Expression& expr) {
-    if (CAST(Identifier, ident, &expr)) {
-        checkVariable(ident->name, ident->line, ident->column);
-    } else if (CAST(BinaryExpression, binExpr, &expr)) {
-        analyzeExpression(*binExpr->left);
-        analyzeExpression(*binExpr->right);
-    } else if (CAST(UnaryExpression, unExpr, &expr)) {
-        analyzeExpression(*unExpr->operand);
-    } else if (CAST(CallExpression, callExpr, &expr)) {
-        analyzeCallExpression(*callExpr);
-    } else if (CAST(ArrayAccess, arrAccess, &expr)) {
-        analyzeArrayAccess(*arrAccess, false);
-    } else if (CAST(PropertyAccess, propAccess, &expr)) {
-        analyzePropertyAccess(*propAccess, false);
-    }
+    visit(expr, Overloaded{
+        [&](Identifier& ident) {
+            checkVariable(ident.name, ident);
+        },
+        [&](BinaryExpression& binExpr) {
+            analyzeExpression(*binExpr.left);
+            analyzeExpression(*binExpr.right);
+        },
+        [&](UnaryExpression& unExpr) {
+            analyzeExpression(*unExpr.operand);
+        },
+        [&](CallExpression& callExpr) {
+            analyzeCallExpression(callExpr);
+        },
+        [&](ArrayAccess& arrAccess) {
+            analyzeArrayAccess(arrAccess, false);
+        },
+        [&](PropertyAccess& propAccess) {
+            analyzePropertyAccess(propAccess, false);
+        },
+        [](NumberLiteral&) {},
+        [](StringLiteral&) {},
+    });
 }
 
 void SemanticAnalyzer::analyzeArrayAccess(const ArrayAccess& expr, const bool isAssignment) {
-    if (CAST(Identifier, ident, expr.array.get())) {
+    if (CAST(Identifier, ident, expr.array)) {
         if (isAssignment) {
             defineVariable(ident->name);
         } else {
-            checkVariable(ident->name, ident->line, ident->column);
+            checkVariable(ident->name, *ident);
         }
-    } else if (CAST(ArrayAccess, nestedAccess, expr.array.get())) {
+    } else if (CAST(ArrayAccess, nestedAccess, expr.array)) {
         analyzeArrayAccess(*nestedAccess, isAssignment);
     } else {
         analyzeExpression(*expr.array);
@@ -147,16 +173,16 @@ void SemanticAnalyzer::analyzeArrayAccess(const ArrayAccess& expr, const bool is
 }
 
 void SemanticAnalyzer::analyzePropertyAccess(const PropertyAccess& expr, const bool isAssignment) {
-    if (CAST(Identifier, objIdent, expr.object.get())) {
-        const std::string& objectName = objIdent->name;
-        const std::string& propertyName = expr.property;
+    if (CAST(Identifier, objIdent, expr.object)) {
+        const std::string objectName = program->name(objIdent->name);
+        const std::string propertyName = program->name(expr.property);
 
         if (registry.hasObject(objectName)) {
             if (!registry.hasProperty(objectName, propertyName)) {
                 if (!registry.hasFunction(objectName, propertyName)) {
                     reporter.addError(
                         "'" + objectName + "' does not have a property or method '" + propertyName + "'",
-                        SourceLocation(expr.line, expr.column, propertyName.length()),
+                        program->location(expr, propertyName.length()),
                         "check the spelling or refer to the documentation"
                     );
                 }
@@ -165,14 +191,14 @@ void SemanticAnalyzer::analyzePropertyAccess(const PropertyAccess& expr, const b
                     if (info->readOnly) {
                         reporter.addError(
                             "cannot assign to read-only property '" + objectName + "." + propertyName + "'",
-                            SourceLocation(expr.line, expr.column, propertyName.length()),
+                            program->location(expr, propertyName.length()),
                             "this property is read-only"
                         );
                     }
                 }
             }
         } else {
-            checkVariable(objectName, objIdent->line, objIdent->column);
+            checkVariable(objIdent->name, *objIdent);
         }
     } else {
         analyzeExpression(*expr.object);
@@ -180,25 +206,21 @@ void SemanticAnalyzer::analyzePropertyAccess(const PropertyAccess& expr, const b
 }
 
 void SemanticAnalyzer::analyzeCallExpression(const CallExpression& expr) {
-    if (CAST(PropertyAccess, propAccess, expr.callee.get())) {
-        if (CAST(Identifier, objIdent, propAccess->object.get())) {
-            const std::string& objectName = objIdent->name;
-            const std::string& methodName = propAccess->property;
+    if (CAST(PropertyAccess, propAccess, expr.callee)) {
+        if (CAST(Identifier, objIdent, propAccess->object)) {
+            const std::string objectName = program->name(objIdent->name);
+            const std::string methodName = program->name(propAccess->property);
 
-            checkFunction(objectName, methodName, expr.arguments.size(),
-                         expr.line, expr.column);
+            checkFunction(objectName, methodName, expr.arguments.size(), expr);
         } else {
             analyzeExpression(*propAccess->object);
         }
-    } else if (CAST(Identifier, ident, expr.callee.get())) {
-        const std::string& subName = ident->name;
-        std::string subNameLower = subName;
-        std::ranges::transform(subNameLower, subNameLower.begin(), ::tolower);
-        
-        if (!subroutines.contains(subNameLower)) {
+    } else if (CAST(Identifier, ident, expr.callee)) {
+        if (!subroutines[program->symbols.folded(ident->name)]) {
+            const std::string subName = program->name(ident->name);
             reporter.addError(
                 "subroutine '" + subName + "' is not defined",
-                SourceLocation(ident->line, ident->column, subName.length()),
+                program->location(*ident, subName.length()),
                 "define the subroutine or check the spelling"
             );
         }
@@ -211,81 +233,86 @@ void SemanticAnalyzer::analyzeCallExpression(const CallExpression& expr) {
     }
 }
 
-void SemanticAnalyzer::checkVariable(const std::string& name, size_t line, size_t col) {
-    std::string nameLower = name;
-    std::ranges::transform(nameLower, nameLower.begin(), ::tolower);
-    
-    if (!variables.contains(nameLower)) {
+void SemanticAnalyzer::checkVariable(const SymbolId name, const ASTNode& at) {
+    const FoldedId key = program->symbols.folded(name);
+
+    if (!variables[key]) {
+        const std::string_view spelling = program->symbols.name(name);
         reporter.addNote(
-            "first use of variable '" + name + "'",
-            SourceLocation(line, col, name.length()),
+            "first use of variable '" + std::string(spelling) + "'",
+            program->location(at, spelling.length()),
             "variables are implicitly initialized to 0 or empty string"
         );
-        variables.insert(nameLower);
+        variables[key] = true;
     }
 }
 
-void SemanticAnalyzer::defineVariable(const std::string& name) {
-    std::string nameLower = name;
-    std::ranges::transform(nameLower, nameLower.begin(), ::tolower);
-    variables.insert(nameLower);
+void SemanticAnalyzer::defineVariable(const SymbolId name) {
+    variables[program->symbols.folded(name)] = true;
 }
 
-void SemanticAnalyzer::defineLabel(const std::string& name, const size_t line, const size_t col) {
-    if (labels.contains(name)) {
+void SemanticAnalyzer::defineLabel(const SymbolId name, const ASTNode& at) {
+    if (labels[name]) {
+        const std::string_view spelling = program->symbols.name(name);
         reporter.addError(
-            "label '" + name + "' is already defined",
-            SourceLocation(line, col, name.length()),
+            "label '" + std::string(spelling) + "' is already defined",
+            program->location(at, spelling.length()),
             "each label must be unique"
         );
     }
-    labels.insert(name);
+    labels[name] = true;
 }
 
-void SemanticAnalyzer::defineSubroutine(const std::string& name, const size_t line, const size_t col) {
-    std::string nameLower = name;
-    std::ranges::transform(nameLower, nameLower.begin(), ::tolower);
-    
-    if (subroutines.contains(nameLower)) {
+void SemanticAnalyzer::defineSubroutine(const SymbolId name, const ASTNode& at) {
+    const FoldedId key = program->symbols.folded(name);
+
+    if (subroutines[key]) {
+        const std::string_view spelling = program->symbols.name(name);
         reporter.addError(
-            "subroutine '" + name + "' is already defined",
-            SourceLocation(line, col, name.length()),
+            "subroutine '" + std::string(spelling) + "' is already defined",
+            program->location(at, spelling.length()),
             "each subroutine must be unique"
         );
     }
-    subroutines.insert(nameLower);
+    subroutines[key] = true;
 }
 
-void SemanticAnalyzer::checkGotoTarget(const std::string& label, const size_t line, const size_t col) {
-    gotoTargets.insert(label);
+void SemanticAnalyzer::checkGotoTarget(const SymbolId label, const ASTNode& at) {
+    gotoTargets[label] = true;
 
     if (inSubroutine) {
         reporter.addWarning(
             "goto statement inside subroutine",
-            SourceLocation(line, col, label.length()),
+            program->location(at, program->symbols.name(label).length()),
             "using goto inside subroutines can make code harder to understand"
         );
     }
 }
 
 void SemanticAnalyzer::verifyAllLabels() const {
-    for (const auto& target : gotoTargets) {
-        if (!labels.contains(target)) {
-            reporter.addError(
-                "goto target '" + target + "' is not defined",
-                SourceLocation(1, 1, target.length()),
-                "define a label with this name or check the spelling"
-            );
+    std::vector<std::string_view> undefined;
+    for (SymbolId id = 0; id < gotoTargets.size(); id++) {
+        if (gotoTargets[id] && !labels[id]) {
+            undefined.push_back(program->symbols.name(id));
         }
     }
+    std::ranges::sort(undefined);
+
+    for (const auto& target : undefined) {
+        reporter.addError(
+            "goto target '" + std::string(target) + "' is not defined",
+            SourceLocation(1, 1, target.length()),
+            "define a label with this name or check the spelling"
+        );
+    }
 }
 
 void SemanticAnalyzer::checkFunction(const std::string& object, const std::string& method,
-                                     const size_t argCount, const size_t line, const size_t col) const {
+                                     const size_t argCount, const ASTNode& at) const {
     if (!registry.hasObject(object)) {
         reporter.addError(
             "unknown object '" + object + "'",
-            SourceLocation(line, col, object.length()),
+            program->location(at, object.length()),
             "this object is not defined in the standard library"
         );
         return;
@@ -294,7 +321,7 @@ void SemanticAnalyzer::checkFunction(const std::string& object, const std::strin
     if (!registry.hasFunction(object, method)) {
         reporter.addError(
             "'" + object + "' does not have a method '" + method + "'",
-            SourceLocation(line, col, method.length()),
+            program->location(at, method.length()),
             "check the spelling or refer to the documentation"
         );
         return;
@@ -306,7 +333,7 @@ void SemanticAnalyzer::checkFunction(const std::string& object, const std::strin
                 "'" + object + "." + method + "' expects " +
                 std::to_string(funcInfo->params.size()) + " argument(s), but got " +
                 std::to_string(argCount),
-                SourceLocation(line, col, method.length()),
+                program->location(at, method.length()),
                 "check the function signature"
             );
         }
@@ -314,11 +341,11 @@ void SemanticAnalyzer::checkFunction(const std::string& object, const std::strin
 }
 
 void SemanticAnalyzer::checkProperty(const std::string& object, const std::string& property,
-                                     const size_t line, const size_t col) const {
+                                     const ASTNode& at) const {
     if (!registry.hasObject(object)) {
         reporter.addError(
             "unknown object '" + object + "'",
-            SourceLocation(line, col, object.length()),
+            program->location(at, object.length()),
             "this object is not defined in the standard library"
         );
         return;
@@ -327,7 +354,7 @@ void SemanticAnalyzer::checkProperty(const std::string& object, const std::strin
     if (!registry.hasProperty(object, property)) {
         reporter.addError(
             "'" + object + "' does not have a property '" + property + "'",
-            SourceLocation(line, col, property.length()),
+            program->location(at, property.length()),
             "check the spelling or refer to the documentation"
         );
     }
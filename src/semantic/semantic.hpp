@@ -1,7 +1,5 @@
 #pragma once
 #include <string>
-#include <map>
-#include <set>
 #include <vector>
 #include "../parser/ast.hpp"
 #include "../diagnostic.hpp"
@@ -10,18 +8,19 @@
 class SemanticAnalyzer {
 public:
     explicit SemanticAnalyzer(DiagnosticReporter& diag)
-        : reporter(diag), inSubroutine(false) {}
+        : reporter(diag), program(nullptr), inSubroutine(false) {}
 
     void analyze(const Program& program);
 
 private:
     DiagnosticReporter& reporter;
-    Registry registry;
+    const Program* program;
 
-    std::set<std::string> variables;
-    std::set<std::string> labels;
-    std::set<std::string> subroutines;
-    std::set<std::string> gotoTargets;
+    // Variables and subroutines are case-insensitive and keyed by FoldedId, labels by SymbolId.
+    std::vector<bool> variables;
+    std::vector<bool> labels;
+    std::vector<bool> subroutines;
+    std::vector<bool> gotoTargets;
 
     bool inSubroutine;
 
@@ -33,14 +32,14 @@ private:
     void analyzePropertyAccess(const PropertyAccess& expr, bool isAssignment);
     void analyzeCallExpression(const CallExpression& expr);
 
-    void checkVariable(const std::string& name, size_t line, size_t col);
-    void defineVariable(const std::string& name);
-    void defineLabel(const std::string& name, size_t line, size_t col);
-    void defineSubroutine(const std::string& name, size_t line, size_t col);
-    void checkGotoTarget(const std::string& label, size_t line, size_t col);
+    void checkVariable(SymbolId name, const ASTNode& at);
+    void defineVariable(SymbolId name);
+    void defineLabel(SymbolId name, const ASTNode& at);
+    void defineSubroutine(SymbolId name, const ASTNode& at);
+    void checkGotoTarget(SymbolId label, const ASTNode& at);
     void verifyAllLabels() const;
     void checkFunction(const std::string& object, const std::string& method,
-                        size_t argCount, size_t line, size_t col) const;
+                        size_t argCount, const ASTNode& at) const;
     void checkProperty(const std::string& object, const std::string& property,
-                        size_t line, size_t col) const;
+                        const ASTNode& at) const;
 };
\ No newline at end of file
@@ -0,0 +1,22 @@
+#include "source.hpp"
+#include <spdlog/spdlog.h>
+
+llvm::Expected<SourceFile> SourceFile::read(const std::string& path) {
+    // without a required NUL terminator MemoryBuffer maps any file large enough to be worth it
+    auto buffer = llvm::MemoryBuffer::getFileOrSTDIN(path, false, false);
+    if (!buffer) {
+        return llvm::errorCodeToError(buffer.getError());
+    }
+
+    SourceFile file(std::move(*buffer));
+    spdlog::debug("Read {} ({} bytes, {})", path, file.text().size(), file.isMapped() ? "mapped" : "buffered");
+    return file;
+}
+
+std::string_view SourceFile::text() const {
+    return {buffer->getBufferStart(), buffer->getBufferSize()};
+}
+
+bool SourceFile::isMapped() const {
+    return buffer->getBufferKind() == llvm::MemoryBuffer::MemoryBuffer_MMap;
+}
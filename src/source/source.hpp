@@ -0,0 +1,21 @@
+#pragma once
+#include <memory>
+#include <string>
+#include <string_view>
+#include <llvm/Support/Error.h>
+#include <llvm/Support/MemoryBuffer.h>
+
+// Read-only source text shared by the lexer, parser and diagnostics, which all keep views into it.
+// Regular files are memory-mapped; stdin ("-") and pipes are read into a single buffer.
+class SourceFile {
+public:
+    static llvm::Expected<SourceFile> read(const std::string& path);
+
+    [[nodiscard]] std::string_view text() const;
+    [[nodiscard]] bool isMapped() const;
+
+private:
+    explicit SourceFile(std::unique_ptr<llvm::MemoryBuffer> buffer) : buffer(std::move(buffer)) {}
+
+    std::unique_ptr<llvm::MemoryBuffer> buffer;
+};
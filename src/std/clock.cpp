@@ -1,7 +1,7 @@
 #include "value.hpp"
 #include <chrono>
-#include <iomanip>
-#include <sstream>
+#include <charconv>
+#include <ctime>
 
 #ifdef _WIN32
 #include <windows.h>
@@ -9,78 +9,99 @@
 
 #include <cmath>
 
-static std::tm get_local_time() {
-    std::time_t t = std::time(nullptr);
-    std::tm tm{};
+// Broken-down local time is only recomputed when the wall clock crosses a
+// second boundary, so tight loops reading Clock.* pay for one std::time call.
+struct ClockSnapshot {
+    std::time_t seconds = -1;
+    std::tm local{};
+    double utcOffsetMs = 0.0;
+};
+
+static ClockSnapshot g_clock;
+
+static const std::chrono::steady_clock::time_point g_clock_origin = std::chrono::steady_clock::now();
+
+static const ClockSnapshot& get_snapshot() {
+    const std::time_t t = std::time(nullptr);
+    if (t == g_clock.seconds) {
+        return g_clock;
+    }
+
+    std::tm utc_tm{};
 #ifdef _WIN32
-    localtime_s(&tm, &t);
+    localtime_s(&g_clock.local, &t);
+    gmtime_s(&utc_tm, &t);
 #else
-    localtime_r(&t, &tm);
+    localtime_r(&t, &g_clock.local);
+    gmtime_r(&t, &utc_tm);
 #endif
-    return tm;
+
+    std::tm local_tm = g_clock.local;
+    g_clock.utcOffsetMs = std::difftime(std::mktime(&local_tm), std::mktime(&utc_tm)) * 1000;
+    g_clock.seconds = t;
+    return g_clock;
 }
 
-static auto get_time_with_millis() {
-    return std::chrono::system_clock::now();
+static char* write_two_digits(char* out, const int value) {
+    out[0] = static_cast<char>('0' + value / 10 % 10);
+    out[1] = static_cast<char>('0' + value % 10);
+    return out + 2;
 }
 
 extern "C" Primitive* clock_time_get() {
-    const std::tm tm = get_local_time();
-    std::ostringstream oss;
-    oss << std::setfill('0') << std::setw(2) << tm.tm_hour << ":"
-        << std::setfill('0') << std::setw(2) << tm.tm_min << ":"
-        << std::setfill('0') << std::setw(2) << tm.tm_sec;
-    return new Primitive(oss.str());
+    const std::tm& tm = get_snapshot().local;
+    char buf[8];
+    char* p = write_two_digits(buf, tm.tm_hour);
+    *p++ = ':';
+    p = write_two_digits(p, tm.tm_min);
+    *p++ = ':';
+    p = write_two_digits(p, tm.tm_sec);
+    return new Primitive(std::string(buf, p));
 }
 
 extern "C" Primitive* clock_date_get() {
-    const std::tm tm = get_local_time();
-    std::ostringstream oss;
-    oss << std::setfill('0') << std::setw(2) << tm.tm_mday << "."
-        << std::setfill('0') << std::setw(2) << (tm.tm_mon + 1) << "."
-        << (tm.tm_year + 1900);
-    return new Primitive(oss.str());
+    const std::tm& tm = get_snapshot().local;
+    char buf[24];
+    char* p = write_two_digits(buf, tm.tm_mday);
+    *p++ = '.';
+    p = write_two_digits(p, tm.tm_mon + 1);
+    *p++ = '.';
+    p = std::to_chars(p, buf + sizeof(buf), tm.tm_year + 1900).ptr;
+    return new Primitive(std::string(buf, p));
 }
 
 // Clock.Year - returns current year
 extern "C" Primitive* clock_year_get() {
-    const std::tm tm = get_local_time();
-    return new Primitive(static_cast<double>(tm.tm_year + 1900));
+    return new Primitive(static_cast<double>(get_snapshot().local.tm_year + 1900));
 }
 
 extern "C" Primitive* clock_month_get() {
-    const std::tm tm = get_local_time();
-    return new Primitive(static_cast<double>(tm.tm_mon + 1));
+    return new Primitive(static_cast<double>(get_snapshot().local.tm_mon + 1));
 }
 
 extern "C" Primitive* clock_day_get() {
-    const std::tm tm = get_local_time();
-    return new Primitive(static_cast<double>(tm.tm_mday));
+    return new Primitive(static_cast<double>(get_snapshot().local.tm_mday));
 }
 
 extern "C" Primitive* clock_weekday_get() {
-    const std::tm tm = get_local_time();
-    const char* days[] = {"Sunday", "Monday", "Tuesday", "Wednesday", "Thursday", "Friday", "Saturday"};
-    return new Primitive(days[tm.tm_wday]);
+    static const char* days[] = {"Sunday", "Monday", "Tuesday", "Wednesday", "Thursday", "Friday", "Saturday"};
+    return new Primitive(days[get_snapshot().local.tm_wday]);
 }
 
 extern "C" Primitive* clock_hour_get() {
-    const std::tm tm = get_local_time();
-    return new Primitive(static_cast<double>(tm.tm_hour));
+    return new Primitive(static_cast<double>(get_snapshot().local.tm_hour));
 }
 
 extern "C" Primitive* clock_minute_get() {
-    const std::tm tm = get_local_time();
-    return new Primitive(static_cast<double>(tm.tm_min));
+    return new Primitive(static_cast<double>(get_snapshot().local.tm_min));
 }
 
 extern "C" Primitive* clock_second_get() {
-    const std::tm tm = get_local_time();
-    return new Primitive(static_cast<double>(tm.tm_sec));
+    return new Primitive(static_cast<double>(get_snapshot().local.tm_sec));
 }
 
 extern "C" Primitive* clock_millisecond_get() {
-    const auto now = get_time_with_millis();
+    const auto now = std::chrono::system_clock::now();
     const auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(now.time_since_epoch()) % 1000;
     return new Primitive(static_cast<double>(ms.count()));
 }
@@ -89,29 +110,27 @@ extern "C" Primitive* clock_elapsedmilliseconds_get() {
     const auto us_since_1970 = std::chrono::duration_cast<std::chrono::microseconds>(
         std::chrono::system_clock::now().time_since_epoch()).count();
 
-    const std::time_t t = std::time(nullptr);
-    std::tm utc_tm{}, local_tm{};
-#ifdef _WIN32
-    gmtime_s(&utc_tm, &t);
-    localtime_s(&local_tm, &t);
-#else
-    gmtime_r(&t, &utc_tm);
-    localtime_r(&t, &local_tm);
-#endif
-
-    const double offset_ms = std::difftime(std::mktime(&local_tm), std::mktime(&utc_tm)) * 1000;
+    const double offset_ms = get_snapshot().utcOffsetMs;
 
     constexpr long long ms_from_1900_to_1970 = 2208988800000LL;
-    const double ms_since_1900 = static_cast<double>(us_since_1970) / 1000.0 + 
+    const double ms_since_1900 = static_cast<double>(us_since_1970) / 1000.0 +
                                   ms_from_1900_to_1970 + offset_ms;
 
-    std::ostringstream oss;
-    oss << std::fixed << std::setprecision(2) << std::round(ms_since_1900 * 100.0) / 100.0;
-    std::string result = oss.str();
-    
+    char buf[64];
+    const auto [end, ec] = std::to_chars(buf, buf + sizeof(buf),
+        std::round(ms_since_1900 * 100.0) / 100.0, std::chars_format::fixed, 2);
+    std::string result(buf, ec == std::errc() ? end : buf);
+
     if (const size_t pos = result.find('.'); pos != std::string::npos) {
         result[pos] = ',';
     }
-    
+
     return new Primitive(result);
 }
+
+// Monotonic, not affected by wall clock adjustments; meant for timing loops.
+extern "C" Primitive* clock_elapsednanoseconds_get() {
+    const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - g_clock_origin).count();
+    return new Primitive(static_cast<double>(ns));
+}
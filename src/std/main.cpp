@@ -8,6 +8,8 @@ extern "C" void runtime_init(const int argc, char** argv) {
 }
 
 extern "C" void runtime_cleanup() {
+    profile_report();
+
     std::cout << "Press any key to continue...";
     std::cin.get();
 }
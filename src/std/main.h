@@ -2,8 +2,16 @@
 #include <iostream>
 #include <string>
 #include <vector>
+#include <cstdint>
 
 #include "value.hpp"
 
 extern "C" void runtime_init(int argc, char** argv);
-extern "C" void runtime_cleanup();
\ No newline at end of file
+extern "C" void runtime_cleanup();
+
+extern "C" void profile_register(const uint64_t* counters, const uint32_t* sites, uint32_t count,
+                                 const char* const* functions, uint32_t functionCount, const char* source);
+extern "C" void profile_start();
+extern "C" void profile_enter();
+extern "C" void profile_leave();
+void profile_report();
\ No newline at end of file
@@ -0,0 +1,219 @@
+#include "main.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <vector>
+
+#ifdef __linux__
+#include <csignal>
+#include <sys/time.h>
+#endif
+
+static const uint64_t* g_profile_counters = nullptr;
+static const uint32_t* g_profile_sites = nullptr;
+static uint32_t g_profile_count = 0;
+static const char* const* g_profile_functions = nullptr;
+static uint32_t g_profile_function_count = 0;
+static std::string g_profile_source;
+
+// Sampling profiler. Instrumented code stores the index of the statement being executed
+// into profile_current_site and pushes it on a shadow stack around subroutine calls;
+// SIGPROF samples that state into a fixed table so the handler never allocates.
+constexpr uint32_t PROFILE_NO_SITE = UINT32_MAX;
+constexpr size_t PROFILE_MAX_DEPTH = 16;
+constexpr size_t PROFILE_STACK_SIZE = 256;
+constexpr size_t PROFILE_TABLE_SIZE = 4096;
+
+extern "C" {
+volatile uint32_t profile_current_site = PROFILE_NO_SITE;
+}
+
+static uint32_t g_profile_stack[PROFILE_STACK_SIZE];
+static volatile uint32_t g_profile_depth = 0;
+
+struct ProfileSample {
+    uint64_t hash;
+    uint64_t count;
+    uint32_t depth;
+    uint32_t frames[PROFILE_MAX_DEPTH];
+};
+
+static ProfileSample g_profile_samples[PROFILE_TABLE_SIZE];
+static uint64_t g_profile_dropped = 0;
+static std::string g_profile_output;
+static bool g_profile_sampling = false;
+
+extern "C" void profile_enter() {
+    if (g_profile_depth < PROFILE_STACK_SIZE) {
+        g_profile_stack[g_profile_depth] = profile_current_site;
+    }
+    g_profile_depth = g_profile_depth + 1;
+}
+
+extern "C" void profile_leave() {
+    g_profile_depth = g_profile_depth - 1;
+    if (g_profile_depth < PROFILE_STACK_SIZE) {
+        profile_current_site = g_profile_stack[g_profile_depth];
+    }
+}
+
+#ifdef __linux__
+static void profile_sample(int) {
+    const uint32_t depth = std::min<uint32_t>(uint32_t{g_profile_depth}, PROFILE_STACK_SIZE);
+
+    // deep recursion keeps only the innermost frames
+    uint32_t frames[PROFILE_MAX_DEPTH];
+    uint32_t count = 0;
+    const uint32_t first = depth + 1 > PROFILE_MAX_DEPTH ? depth + 1 - PROFILE_MAX_DEPTH : 0;
+    for (uint32_t i = first; i < depth; ++i) {
+        frames[count++] = g_profile_stack[i];
+    }
+    frames[count++] = profile_current_site;
+
+    uint64_t hash = 1469598103934665603ULL;
+    for (uint32_t i = 0; i < count; ++i) {
+        hash = (hash ^ frames[i]) * 1099511628211ULL;
+    }
+    hash |= 1;
+
+    for (size_t probe = 0; probe < PROFILE_TABLE_SIZE; ++probe) {
+        ProfileSample& sample = g_profile_samples[(hash + probe) & (PROFILE_TABLE_SIZE - 1)];
+        if (sample.hash == 0) {
+            sample.hash = hash;
+            sample.depth = count;
+            std::copy_n(frames, count, sample.frames);
+        } else if (sample.hash != hash || sample.depth != count ||
+                   !std::equal(frames, frames + count, sample.frames)) {
+            continue;
+        }
+        ++sample.count;
+        return;
+    }
+    ++g_profile_dropped;
+}
+
+static void profile_start_sampling() {
+    struct sigaction action{};
+    action.sa_handler = profile_sample;
+    action.sa_flags = SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    if (sigaction(SIGPROF, &action, nullptr) != 0) return;
+
+    itimerval timer{};
+    timer.it_interval.tv_usec = 1000;
+    timer.it_value.tv_usec = 1000;
+    g_profile_sampling = setitimer(ITIMER_PROF, &timer, nullptr) == 0;
+}
+
+static void profile_stop_sampling() {
+    itimerval timer{};
+    setitimer(ITIMER_PROF, &timer, nullptr);
+    signal(SIGPROF, SIG_IGN);
+}
+#else
+static void profile_start_sampling() {
+    std::cerr << "SMALLBASIC_PROFILE: sampling is only supported on Linux" << std::endl;
+}
+
+static void profile_stop_sampling() {}
+#endif
+
+static void profile_write_frame(std::ostream& out, const uint32_t site) {
+    if (site == PROFILE_NO_SITE || site >= g_profile_count) {
+        out << "Main";
+        return;
+    }
+    const uint32_t function = g_profile_sites[site * 3 + 2];
+    out << (function < g_profile_function_count ? g_profile_functions[function] : "?")
+        << ":" << g_profile_sites[site * 3];
+}
+
+// Writes one folded stack per line ("Main:12;Foo:40 37"), the format flamegraph.pl and speedscope read.
+static void profile_report_samples() {
+    if (!g_profile_sampling) return;
+    profile_stop_sampling();
+    g_profile_sampling = false;
+
+    std::ofstream out(g_profile_output);
+    if (!out.is_open()) {
+        std::cerr << "Could not write profile samples: " << g_profile_output << std::endl;
+        return;
+    }
+
+    for (const ProfileSample& sample : g_profile_samples) {
+        if (sample.count == 0) continue;
+        for (uint32_t i = 0; i < sample.depth; ++i) {
+            if (i > 0) out << ";";
+            profile_write_frame(out, sample.frames[i]);
+        }
+        out << " " << sample.count << "\n";
+    }
+
+    if (g_profile_dropped > 0) {
+        std::cerr << "SMALLBASIC_PROFILE: " << g_profile_dropped << " samples dropped, stack table full" << std::endl;
+    }
+}
+
+extern "C" void profile_register(const uint64_t* counters, const uint32_t* sites, const uint32_t count,
+                                 const char* const* functions, const uint32_t functionCount, const char* source) {
+    g_profile_counters = counters;
+    g_profile_sites = sites;
+    g_profile_count = count;
+    g_profile_functions = functions;
+    g_profile_function_count = functionCount;
+    g_profile_source = source;
+}
+
+// Emitted after profile_register by --profile-sampling builds; sampling only runs when
+// SMALLBASIC_PROFILE names the file the folded stacks should go to.
+extern "C" void profile_start() {
+    const char* output = std::getenv("SMALLBASIC_PROFILE");
+    if (!output || !*output) return;
+    g_profile_output = output;
+    profile_start_sampling();
+}
+
+// Writes <source>.profile.txt with the hottest lines followed by the source annotated with counts.
+void profile_report() {
+    profile_report_samples();
+    if (!g_profile_counters) return;
+
+    // several statements can share a line, the line reports the most executed one
+    std::map<uint32_t, uint64_t> lineCounts;
+    for (uint32_t i = 0; i < g_profile_count; ++i) {
+        uint64_t& count = lineCounts[g_profile_sites[i * 3]];
+        count = std::max(count, g_profile_counters[i]);
+    }
+    g_profile_counters = nullptr;
+
+    std::vector<std::pair<uint32_t, uint64_t>> hot(lineCounts.begin(), lineCounts.end());
+    std::ranges::stable_sort(hot, std::ranges::greater{}, &std::pair<uint32_t, uint64_t>::second);
+
+    const std::filesystem::path sourcePath(g_profile_source);
+    // next to the source, so programs compiled from same-named sources in different directories don't collide
+    const std::filesystem::path reportPath = sourcePath.parent_path() / (sourcePath.stem().string() + ".profile.txt");
+    std::ofstream out(reportPath);
+    if (!out.is_open()) {
+        std::cerr << "Could not write profile report: " << reportPath.string() << std::endl;
+        return;
+    }
+
+    out << "Hot lines in " << g_profile_source << ":\n";
+    for (size_t i = 0; i < hot.size() && i < 20; ++i) {
+        out << "  line " << hot[i].first << ": " << hot[i].second << "\n";
+    }
+
+    std::ifstream source(sourcePath);
+    if (!source.is_open()) return;
+
+    out << "\nAnnotated source:\n";
+    std::string text;
+    for (uint32_t line = 1; std::getline(source, text); ++line) {
+        const auto it = lineCounts.find(line);
+        const std::string count = it != lineCounts.end() ? std::to_string(it->second) : "";
+        out << std::string(count.size() < 12 ? 12 - count.size() : 0, ' ') << count << " | " << text << "\n";
+    }
+}
@@ -0,0 +1,121 @@
+#include "timing.hpp"
+#include <llvm/IR/PassTimingInfo.h>
+#include <llvm/Pass.h>
+#include <llvm/Support/Process.h>
+#include <llvm/Support/Timer.h>
+#include <llvm/Support/raw_os_ostream.h>
+#include <fmt/format.h>
+
+#ifdef _WIN32
+    #include <windows.h>
+    #include <psapi.h>
+#elif __linux__
+    #include <sys/resource.h>
+#endif
+
+static std::string escapeJson(const std::string& value) {
+    std::string escaped;
+    escaped.reserve(value.size());
+    for (const char c : value) {
+        if (c == '"' || c == '\\') escaped += '\\';
+        escaped += c;
+    }
+    return escaped;
+}
+
+TimeReport::TimeReport(const bool enabled, const TimeReportFormat format)
+    : enabled(enabled), format(format) {
+    // LLVM records per-pass timings of the object emission pipeline
+    if (enabled) {
+        llvm::TimePassesIsEnabled = true;
+    }
+}
+
+TimeReport::Sample TimeReport::Sample::now() {
+    Sample sample{};
+    sample.wall = std::chrono::steady_clock::now();
+
+    llvm::sys::TimePoint<> elapsed;
+    std::chrono::nanoseconds user, system;
+    llvm::sys::Process::GetTimeUsage(elapsed, user, system);
+    sample.cpu = user + system;
+
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        sample.peakRSS = counters.PeakWorkingSetSize;
+    }
+#elif __linux__
+    rusage usage{};
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+        sample.peakRSS = static_cast<size_t>(usage.ru_maxrss) * 1024;
+    }
+#endif
+
+    return sample;
+}
+
+TimeReport::Scope::Scope(TimeReport& report, const std::string& name)
+    : report(report), name(name), start(report.enabled ? Sample::now() : Sample{}) {}
+
+TimeReport::Scope::~Scope() {
+    if (!report.enabled) return;
+
+    const Sample end = Sample::now();
+    report.phases.push_back({
+        name,
+        std::chrono::duration<double, std::milli>(end.wall - start.wall).count(),
+        std::chrono::duration<double, std::milli>(end.cpu - start.cpu).count(),
+        (static_cast<long long>(end.peakRSS) - static_cast<long long>(start.peakRSS)) / 1024
+    });
+}
+
+void TimeReport::print(std::ostream& out, const std::string& filename) const {
+    if (!enabled) return;
+
+    if (format == TimeReportFormat::Json) {
+        printJson(out, filename);
+    } else {
+        printText(out, filename);
+    }
+}
+
+void TimeReport::printText(std::ostream& out, const std::string& filename) const {
+    double totalWall = 0, totalCpu = 0;
+    long long totalRSS = 0;
+
+    out << "===-- Time report: " << filename << " --===\n";
+    out << fmt::format("{:<24}{:>14}{:>14}{:>18}\n", "Phase", "Wall (ms)", "CPU (ms)", "Peak RSS (+KiB)");
+    for (const auto& phase : phases) {
+        out << fmt::format("{:<24}{:>14.3f}{:>14.3f}{:>18}\n", phase.name, phase.wallMs, phase.cpuMs, phase.peakRSSDeltaKiB);
+        totalWall += phase.wallMs;
+        totalCpu += phase.cpuMs;
+        totalRSS += phase.peakRSSDeltaKiB;
+    }
+    out << fmt::format("{:<24}{:>14.3f}{:>14.3f}{:>18}\n", "Total", totalWall, totalCpu, totalRSS);
+    out.flush();
+
+    llvm::raw_os_ostream llvmOut(out);
+    llvm::reportAndResetTimings(&llvmOut);
+}
+
+void TimeReport::printJson(std::ostream& out, const std::string& filename) const {
+    out << "{\n  \"file\": \"" << escapeJson(filename) << "\",\n  \"phases\": [";
+
+    const char* separator = "";
+    for (const auto& phase : phases) {
+        out << separator << fmt::format(
+            "\n    {{\"name\": \"{}\", \"wall_ms\": {:.3f}, \"cpu_ms\": {:.3f}, \"peak_rss_delta_kib\": {}}}",
+            phase.name, phase.wallMs, phase.cpuMs, phase.peakRSSDeltaKiB);
+        separator = ",";
+    }
+
+    out << "\n  ],\n  \"llvm\": {";
+    {
+        llvm::raw_os_ostream llvmOut(out);
+        llvm::TimerGroup::printAllJSONValues(llvmOut, "");
+    }
+    // as clang does, otherwise LLVM still prints its text report to stderr at exit, after the JSON
+    llvm::TimerGroup::clearAll();
+    out << "\n  }\n}" << std::endl;
+}
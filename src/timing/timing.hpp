@@ -0,0 +1,62 @@
+#pragma once
+
+#include <chrono>
+#include <ostream>
+#include <string>
+#include <vector>
+
+enum class TimeReportFormat {
+    Text,
+    Json
+};
+
+// Collects wall time, CPU time and peak RSS growth of each compiler phase.
+// When disabled, measure() only forwards to the wrapped callable.
+class TimeReport {
+public:
+    explicit TimeReport(bool enabled = false, TimeReportFormat format = TimeReportFormat::Text);
+
+    template <typename F>
+    auto measure(const std::string& phase, F&& f) {
+        Scope scope(*this, phase);
+        return f();
+    }
+
+    [[nodiscard]] bool isEnabled() const { return enabled; }
+
+    void print(std::ostream& out, const std::string& filename) const;
+
+private:
+    struct Sample {
+        std::chrono::steady_clock::time_point wall;
+        std::chrono::nanoseconds cpu;
+        size_t peakRSS;
+
+        static Sample now();
+    };
+
+    struct Phase {
+        std::string name;
+        double wallMs;
+        double cpuMs;
+        long long peakRSSDeltaKiB;
+    };
+
+    class Scope {
+    public:
+        Scope(TimeReport& report, const std::string& name);
+        ~Scope();
+
+    private:
+        TimeReport& report;
+        std::string name;
+        Sample start;
+    };
+
+    bool enabled;
+    TimeReportFormat format;
+    std::vector<Phase> phases;
+
+    void printText(std::ostream& out, const std::string& filename) const;
+    void printJson(std::ostream& out, const std::string& filename) const;
+};